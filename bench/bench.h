@@ -0,0 +1,174 @@
+#pragma once
+
+#include <leech/model.hpp>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define BENCH_FORK
+#endif
+
+// Counted by the replaced global operator new in main.cpp.
+extern std::atomic<size_t> bench_allocations;
+
+// A record with one required field and many optional ones, decoded from
+// documents that carry only the required field.
+struct Sparse
+{
+	int id;
+	int o1, o2, o3, o4, o5, o6, o7, o8, o9, o10, o11, o12;
+	std::string s1, s2, s3, s4;
+};
+
+STRUCT_MODEL(Sparse, id, ((o1), optional), ((o2), optional), ((o3), optional), ((o4), optional),
+	((o5), optional), ((o6), optional), ((o7), optional), ((o8), optional), ((o9), optional),
+	((o10), optional), ((o11), optional), ((o12), optional),
+	((s1), optional), ((s2), optional), ((s3), optional), ((s4), optional))
+
+const size_t sparse_count = 10000;
+
+// Forwards a document without its has_child hook, so missing optional
+// fields are detected by catching the exception thrown from child().
+template<typename Document>
+class throwing_lookup
+{
+public:
+	typedef typename Document::element_type element_type;
+
+	explicit throwing_lookup(const Document& doc) : _doc(doc) { }
+
+	decltype(auto) root() const { return _doc.root(); }
+	decltype(auto) child(const element_type& element, const char* name) const
+	{
+		return _doc.child(element, name);
+	}
+	template<typename T>
+	void get(const element_type& element, T& v) const
+	{
+		_doc.get(element, v);
+	}
+
+private:
+	const Document& _doc;
+};
+
+inline std::string quote(const std::string& text)
+{
+	std::string result = "\"";
+	for (char c : text)
+	{
+		if (c == '"' || c == '\\') result += '\\';
+		result += static_cast<unsigned char>(c) < 0x20 ? ' ' : c;
+	}
+	return result + '"';
+}
+
+// Peak resident set size of this process, in KB.
+inline long peak_rss_kb()
+{
+#ifdef BENCH_FORK
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024;
+#else
+	return usage.ru_maxrss;
+#endif
+#else
+	return 0;
+#endif
+}
+
+// Peak RSS when the current case started, so the growth of the case itself can be reported.
+inline long& case_start_rss_kb()
+{
+	static long value = 0;
+	return value;
+}
+
+// Prints one JSON object per measurement, so runs can be compared by tools.
+template<typename Fn>
+inline void measure(const char* backend, const char* name, size_t ops, Fn&& fn)
+{
+	fn();
+	size_t allocations = bench_allocations.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	allocations = bench_allocations.load(std::memory_order_relaxed) - allocations;
+	std::cout << "{\"backend\":\"" << backend << "\",\"case\":\"" << name
+		<< "\",\"ops\":" << ops << ",\"ns_per_op\":" << elapsed / ops
+		<< ",\"allocs_per_op\":" << static_cast<double>(allocations) / ops << "}" << std::endl;
+}
+
+// Repeats fn for about min_ns and prints time, throughput over bytes per op,
+// allocations per op, the peak RSS of the process and how much it grew during the case.
+template<typename Fn>
+inline void measure_throughput(const char* backend, const std::string& name, size_t bytes, Fn&& fn, double min_ns = 2e8)
+{
+	fn();
+	size_t ops = 0;
+	size_t allocations = bench_allocations.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	double elapsed;
+	do
+	{
+		fn();
+		++ops;
+		elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	} while (elapsed < min_ns);
+	allocations = bench_allocations.load(std::memory_order_relaxed) - allocations;
+	std::cout << "{\"backend\":\"" << backend << "\",\"case\":" << quote(name)
+		<< ",\"ops\":" << ops << ",\"bytes\":" << bytes << ",\"ns_per_op\":" << elapsed / ops
+		<< ",\"mb_per_s\":" << bytes * ops / elapsed * 1e3
+		<< ",\"allocs_per_op\":" << static_cast<double>(allocations) / ops
+		<< ",\"peak_rss_kb\":" << peak_rss_kb()
+		<< ",\"rss_growth_kb\":" << peak_rss_kb() - case_start_rss_kb() << "}" << std::endl;
+}
+
+inline void report_error(const char* backend, const std::string& name, const std::string& error)
+{
+	std::cout << "{\"backend\":\"" << backend << "\",\"case\":" << quote(name)
+		<< ",\"error\":" << quote(error) << "}" << std::endl;
+}
+
+// Runs one case in a child process where fork is available, so its peak RSS
+// is not hidden by earlier cases; a failing case is reported instead of stopping the run.
+template<typename Fn>
+inline void isolated(const char* backend, const std::string& name, Fn&& fn)
+{
+	auto run = [&]() {
+		case_start_rss_kb() = peak_rss_kb();
+		try
+		{
+			fn();
+		}
+		catch (std::exception& e)
+		{
+			report_error(backend, name, e.what());
+		}
+	};
+	std::cout.flush();
+#ifdef BENCH_FORK
+	pid_t pid = fork();
+	if (pid == 0)
+	{
+		run();
+		std::cout.flush();
+		_exit(0);
+	}
+	if (pid > 0)
+	{
+		int status = 0;
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			report_error(backend, name, "crashed");
+		return;
+	}
+#endif
+	run();
+}
@@ -0,0 +1,50 @@
+#include "shapes.h"
+#include <leech/binary.hpp>
+
+struct binary_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::binary::document doc;
+		leech::put(doc, v);
+		return doc.save();
+	}
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::binary::document doc(text.data(), text.size());
+		leech::get(doc, v);
+	}
+};
+
+template<typename T>
+static size_t weight(const T& v) { return static_cast<size_t>(v); }
+static size_t weight(const std::string& v) { return v.size(); }
+
+void bench_binary()
+{
+	// Table-driven access: reads the fields of a projection, chosen at run time, by index.
+	std::vector<Wide> records(sparse_count);
+	generator gen(1);
+	for (Wide& v : records)
+		generate(gen, v, 0);
+	std::vector<size_t> columns;
+	for (size_t i = leech::field_count<Wide>(); i-- != 0; )
+		columns.push_back(i);
+	size_t total = 0;
+	measure("binary", "wide/find_field_index", sparse_count, [&]() {
+		for (const Wide& record : records)
+		{
+			for (size_t column : columns)
+			{
+				leech::find_field<Wide>(column, [&](const auto& field) {
+					total += weight(field.get_value(record));
+				});
+			}
+		}
+	});
+	if (total == 1) std::cout << total;
+
+	bench_shapes<binary_codec>("binary");
+}
@@ -0,0 +1,82 @@
+#include "shapes.h"
+#include <leech/config.hpp>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+
+struct config_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::config::document doc;
+		leech::config::setting root = doc.root();
+		leech::put(doc, root, v);
+		char* buffer = nullptr;
+		size_t size = 0;
+		FILE* stream = open_memstream(&buffer, &size);
+		doc.save(stream);
+		fclose(stream);
+		std::string text(buffer, size);
+		free(buffer);
+		return text;
+	}
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::config::document doc;
+		doc.load(text);
+		leech::get(doc, v);
+	}
+};
+
+// Decodes with leech::config::read, which does not build a config_setting_t tree.
+struct config_read_codec : public config_codec
+{
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::config::read(text, v);
+	}
+};
+
+void bench_config()
+{
+	std::ostringstream text;
+	text << "items = (";
+	for (size_t i = 0; i != sparse_count; i++)
+		text << (i ? ", " : "") << "{ id = " << i << "; }";
+	text << ");";
+	leech::config::document doc;
+	doc.load(text.str());
+	throwing_lookup<leech::config::document> legacy(doc);
+	leech::config::setting items = doc.lookup("items");
+	Sparse v{ };
+
+	measure("config", "sparse/throw", sparse_count, [&]() {
+		for (size_t i = 0; i != items.size(); i++)
+			leech::get(legacy, items[i], v);
+	});
+	measure("config", "sparse/has_child", sparse_count, [&]() {
+		for (size_t i = 0; i != items.size(); i++)
+			leech::get(doc, items[i], v);
+	});
+
+	// Writes again into the document holding the previous value, which reuses its settings.
+	Series series{ };
+	generator gen(1);
+	generate(gen, series, 100000);
+	leech::config::document target;
+	leech::config::setting root = target.root();
+	measure("config", "vector/100000/put", 1, [&]() {
+		leech::put(target, root, series);
+	});
+	Index index{ };
+	generate(gen, index, 10000);
+	measure("config", "map/10000/put", 1, [&]() {
+		leech::put(target, root, index);
+	});
+
+	bench_shapes<config_codec>("config");
+	bench_shapes<config_read_codec>("config-read");
+}
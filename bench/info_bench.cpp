@@ -0,0 +1,82 @@
+#include "shapes.h"
+#include <leech/info.hpp>
+
+struct info_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::info::document doc;
+		leech::put(doc, v);
+		std::string text;
+		doc.save(text);
+		return text;
+	}
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::info::document doc = leech::info::document::load(text);
+		leech::get(doc, v);
+	}
+};
+
+void bench_info()
+{
+	boost::property_tree::ptree items;
+	for (size_t i = 0; i != sparse_count; i++)
+	{
+		boost::property_tree::ptree item;
+		item.put("id", i);
+		items.push_back(std::make_pair(std::to_string(i), item));
+	}
+	leech::info::document doc(std::move(items));
+	throwing_lookup<leech::info::document> legacy(doc);
+	Sparse v{ };
+
+	measure("info", "sparse/throw", sparse_count, [&]() {
+		for (const auto& item : doc.root())
+			leech::get(legacy, item.second, v);
+	});
+	measure("info", "sparse/has_child", sparse_count, [&]() {
+		for (const auto& item : doc.root())
+			leech::get(doc, item.second, v);
+	});
+
+	// Field lookup alone, which is a linear search per field in a ptree.
+	boost::property_tree::ptree records;
+	for (size_t i = 0; i != sparse_count; i++)
+	{
+		boost::property_tree::ptree record;
+		for (const leech::field_descriptor& d : leech::field_table<Wide>)
+			record.put(d.name, i);
+		records.push_back(std::make_pair(std::to_string(i), record));
+	}
+	leech::info::document wide_doc(std::move(records));
+	Wide wide{ };
+	measure("info", "wide/get", sparse_count, [&]() {
+		for (const auto& item : wide_doc.root())
+			leech::get(wide_doc, item.second, wide);
+	});
+	measure("info", "wide/get_ordered", sparse_count, [&]() {
+		for (const auto& item : wide_doc.root())
+			leech::get_ordered(wide_doc, item.second, wide);
+	});
+
+	// Maps of maps of vectors, whose children are written in place.
+	std::map<std::string, std::map<std::string, std::vector<int>>> nested;
+	for (size_t i = 0; i != 100; i++)
+	{
+		for (size_t j = 0; j != 100; j++)
+			nested["key" + std::to_string(i)]["key" + std::to_string(j)].assign(10, static_cast<int>(j));
+	}
+	leech::info::document target;
+	measure("info", "nested/put", 1, [&]() {
+		leech::put(target, nested);
+	});
+	std::map<std::string, std::map<std::string, std::vector<int>>> result;
+	measure("info", "nested/get", 1, [&]() {
+		leech::get(target, result);
+	});
+
+	bench_shapes<info_codec>("info");
+}
@@ -0,0 +1,110 @@
+#include "shapes.h"
+#include <leech/json.hpp>
+#include <leech/delta.hpp>
+
+struct json_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::json::document doc;
+		leech::put(doc, v);
+		return doc.save();
+	}
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::json::document doc = leech::json::load(text);
+		leech::get(doc, v);
+	}
+};
+
+// leech::json::writer and leech::json::read, which do not build a nlohmann::json tree.
+struct json_stream_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::json::writer writer;
+		leech::put(writer, v);
+		return writer.str();
+	}
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::json::read(text, v);
+	}
+};
+
+void bench_json()
+{
+	nlohmann::json items = nlohmann::json::array();
+	for (size_t i = 0; i != sparse_count; i++)
+		items.push_back({ { "id", i } });
+	leech::json::document doc(std::move(items));
+	throwing_lookup<leech::json::document> legacy(doc);
+	Sparse v{ };
+
+	measure("json", "sparse/throw", sparse_count, [&]() {
+		for (const auto& item : doc.root())
+			leech::get(legacy, item, v);
+	});
+	measure("json", "sparse/has_child", sparse_count, [&]() {
+		for (const auto& item : doc.root())
+			leech::get(doc, item, v);
+	});
+
+	// Field lookup alone, on records that were parsed up front.
+	nlohmann::json records = nlohmann::json::array();
+	generator gen(1);
+	Wide wide{ };
+	for (size_t i = 0; i != sparse_count; i++)
+	{
+		generate(gen, wide, 0);
+		leech::json::document record;
+		leech::put(record, wide);
+		records.push_back(std::move(record.root()));
+	}
+	leech::json::document wide_doc(std::move(records));
+	measure("json", "wide/get", sparse_count, [&]() {
+		for (const auto& item : wide_doc.root())
+			leech::get(wide_doc, item, wide);
+	});
+	measure("json", "wide/get_ordered", sparse_count, [&]() {
+		for (const auto& item : wide_doc.root())
+			leech::get_ordered(wide_doc, item, wide);
+	});
+
+	// A full snapshot against a delta of one changed field, diff included.
+	Wide updated = wide;
+	updated.i3 += 1;
+	leech::json::writer snapshot;
+	measure("json", "wide/put", sparse_count, [&]() {
+		for (size_t i = 0; i != sparse_count; i++)
+		{
+			snapshot.clear();
+			leech::put(snapshot, updated);
+		}
+	});
+	measure("json", "wide/put_delta", sparse_count, [&]() {
+		for (size_t i = 0; i != sparse_count; i++)
+		{
+			snapshot.clear();
+			leech::put_delta(snapshot, leech::diff(wide, updated));
+		}
+	});
+	// Re-encoding the text of a value with one dirty field.
+	leech::tracked<Wide> state(updated);
+	leech::json::fragment_cache<Wide> cache;
+	cache.str(state);
+	measure("json", "wide/fragment_cache", sparse_count, [&]() {
+		for (size_t i = 0; i != sparse_count; i++)
+		{
+			state.edit(&Wide::i3) += 1;
+			cache.str(state);
+		}
+	});
+
+	bench_shapes<json_codec>("json");
+	bench_shapes<json_stream_codec>("json-stream");
+}
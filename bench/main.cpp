@@ -0,0 +1,57 @@
+#include "bench.h"
+#include <new>
+#include <stdlib.h>
+
+std::atomic<size_t> bench_allocations(0);
+
+void* operator new(size_t size)
+{
+	bench_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = malloc(size ? size : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept
+{
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+	free(p);
+}
+
+void bench_json();
+void bench_yaml();
+void bench_toml();
+void bench_info();
+void bench_config();
+void bench_binary();
+void bench_watched();
+
+int main()
+{
+#ifdef BENCH_json
+	bench_json();
+#endif
+#ifdef BENCH_yaml
+	bench_yaml();
+#endif
+#ifdef BENCH_toml
+	bench_toml();
+#endif
+#ifdef BENCH_info
+	bench_info();
+#endif
+#ifdef BENCH_config
+	bench_config();
+#endif
+#ifdef BENCH_binary
+	bench_binary();
+#endif
+#ifdef BENCH_watched
+	bench_watched();
+#endif
+	return 0;
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "bench.h"
+#include "test.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// An xorshift generator with a fixed seed, so every run and every backend encodes the same data.
+class generator
+{
+public:
+	explicit generator(std::uint64_t seed) : _state(seed * 0x9e3779b97f4a7c15ull + 1) { }
+
+	std::uint64_t next()
+	{
+		_state ^= _state << 13;
+		_state ^= _state >> 7;
+		_state ^= _state << 17;
+		return _state;
+	}
+	int integer(int limit) { return static_cast<int>(next() % static_cast<std::uint64_t>(limit)); }
+	double real() { return static_cast<double>(next() >> 11) / 9007199254740992.0 * 1000.0; }
+	bool boolean() { return (next() & 1) != 0; }
+	std::string text(size_t length)
+	{
+		static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 _-";
+		std::string result(length, ' ');
+		for (char& c : result)
+			c = letters[next() % (sizeof(letters) - 1)];
+		return result;
+	}
+
+private:
+	std::uint64_t _state;
+};
+
+// Few scalar fields.
+struct Flat
+{
+	int id;
+	bool enabled;
+	double score;
+	std::string name;
+	std::string email;
+};
+
+STRUCT_MODEL(Flat, id, enabled, score, name, email)
+
+// Nested structures, with MyStruct and MyNode of the smoke tests at the bottom.
+struct Deep3
+{
+	MyStruct record;
+	MyNode tag;
+};
+
+struct Deep2
+{
+	int level;
+	Deep3 inner;
+};
+
+struct Deep1
+{
+	int level;
+	Deep2 inner;
+};
+
+struct Deep
+{
+	std::string name;
+	Deep1 inner;
+};
+
+STRUCT_MODEL(Deep3, record, tag)
+STRUCT_MODEL(Deep2, level, inner)
+STRUCT_MODEL(Deep1, level, inner)
+STRUCT_MODEL(Deep, name, inner)
+
+// Many fields, which stresses field lookup by name.
+struct Wide
+{
+	int i0, i1, i2, i3, i4, i5, i6, i7;
+	double d0, d1, d2, d3, d4, d5, d6, d7;
+	std::string s0, s1, s2, s3, s4, s5, s6, s7;
+};
+
+STRUCT_MODEL(Wide, i0, i1, i2, i3, i4, i5, i6, i7, d0, d1, d2, d3, d4, d5, d6, d7, s0, s1, s2, s3, s4, s5, s6, s7)
+
+// A large vector of numbers.
+struct Series
+{
+	std::string name;
+	std::vector<double> values;
+};
+
+STRUCT_MODEL(Series, name, values)
+
+// A large map.
+struct Index
+{
+	std::string name;
+	std::map<std::string, int> entries;
+};
+
+STRUCT_MODEL(Index, name, entries)
+
+inline void generate(generator& gen, Flat& v, size_t)
+{
+	v.id = gen.integer(1000000);
+	v.enabled = gen.boolean();
+	v.score = gen.real();
+	v.name = gen.text(12);
+	v.email = gen.text(20);
+}
+
+inline void generate(generator& gen, Deep& v, size_t)
+{
+	v.name = gen.text(12);
+	v.inner.level = 1;
+	v.inner.inner.level = 2;
+	MyStruct& record = v.inner.inner.inner.record;
+	record.id = gen.integer(1000000);
+	record.enabled = gen.boolean();
+	record.a = gen.integer(1000);
+	record.b = gen.integer(1000);
+	record.c = gen.integer(1000);
+	record.d.resize(8);
+	for (int& item : record.d)
+		item = gen.integer(1000);
+	record.node.name = gen.text(16);
+	v.inner.inner.inner.tag.name = gen.text(8);
+}
+
+inline void generate(generator& gen, Wide& v, size_t)
+{
+	for (int* item : { &v.i0, &v.i1, &v.i2, &v.i3, &v.i4, &v.i5, &v.i6, &v.i7 })
+		*item = gen.integer(1000000);
+	for (double* item : { &v.d0, &v.d1, &v.d2, &v.d3, &v.d4, &v.d5, &v.d6, &v.d7 })
+		*item = gen.real();
+	for (std::string* item : { &v.s0, &v.s1, &v.s2, &v.s3, &v.s4, &v.s5, &v.s6, &v.s7 })
+		*item = gen.text(10);
+}
+
+inline void generate(generator& gen, Series& v, size_t size)
+{
+	v.name = gen.text(12);
+	v.values.resize(size);
+	for (double& item : v.values)
+		item = gen.real();
+}
+
+inline void generate(generator& gen, Index& v, size_t size)
+{
+	v.name = gen.text(12);
+	v.entries.clear();
+	for (size_t i = 0; i != size; i++)
+		v.entries["key" + std::to_string(i)] = gen.integer(1000000);
+}
+
+// Encodes and decodes one generated value with Codec, each in its own process.
+// Codec provides static std::string encode(const T&) and void decode(const std::string&, T&).
+template<typename Codec, typename T>
+inline void bench_shape(const char* backend, const char* shape, size_t size = 0)
+{
+	std::string name = size ? std::string(shape) + "/" + std::to_string(size) : std::string(shape);
+	isolated(backend, name + "/encode", [&]() {
+		T v{ };
+		generator gen(size + 1);
+		generate(gen, v, size);
+		std::string text = Codec::encode(v);
+		measure_throughput(backend, name + "/encode", text.size(), [&]() {
+			text = Codec::encode(v);
+		});
+	});
+	isolated(backend, name + "/decode", [&]() {
+		T v{ };
+		generator gen(size + 1);
+		generate(gen, v, size);
+		std::string text = Codec::encode(v);
+		measure_throughput(backend, name + "/decode", text.size(), [&]() {
+			T result{ };
+			Codec::decode(text, result);
+		});
+	});
+}
+
+template<typename Codec>
+inline void bench_shapes(const char* backend)
+{
+	bench_shape<Codec, Flat>(backend, "flat");
+	bench_shape<Codec, Deep>(backend, "deep");
+	bench_shape<Codec, Wide>(backend, "wide");
+	bench_shape<Codec, Series>(backend, "vector", 100);
+	bench_shape<Codec, Series>(backend, "vector", 100000);
+	bench_shape<Codec, Index>(backend, "map", 100);
+	bench_shape<Codec, Index>(backend, "map", 10000);
+}
@@ -0,0 +1,54 @@
+#include "shapes.h"
+#include <leech/toml.hpp>
+#include <sstream>
+
+struct toml_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::toml::document doc{ ::toml::value(::toml::table()) };
+		leech::put(doc, v);
+		return doc.save();
+	}
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		std::istringstream is(text);
+		leech::toml::document doc = leech::toml::load(is);
+		leech::get(doc, v);
+	}
+};
+
+struct toml_writer_codec : public toml_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::toml::writer writer;
+		leech::put(writer, v);
+		return writer.str();
+	}
+};
+
+void bench_toml()
+{
+	::toml::array items;
+	for (size_t i = 0; i != sparse_count; i++)
+		items.push_back(::toml::table{ { "id", static_cast<::toml::integer>(i) } });
+	leech::toml::document doc(::toml::table{ { "items", items } });
+	throwing_lookup<leech::toml::document> legacy(doc);
+	Sparse v{ };
+
+	measure("toml", "sparse/throw", sparse_count, [&]() {
+		for (const auto& item : doc["items"].as_array())
+			leech::get(legacy, item, v);
+	});
+	measure("toml", "sparse/has_child", sparse_count, [&]() {
+		for (const auto& item : doc["items"].as_array())
+			leech::get(doc, item, v);
+	});
+
+	bench_shapes<toml_codec>("toml");
+	bench_shapes<toml_writer_codec>("toml-writer");
+}
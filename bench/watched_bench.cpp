@@ -0,0 +1,92 @@
+#include "shapes.h"
+#include <leech/json.hpp>
+#include <leech/watched.hpp>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <stdio.h>
+
+// Runs read on each of threads readers for reads_per_thread calls while the
+// file is reloaded about every millisecond, and prints the time per read.
+template<typename Read>
+static void measure_readers(const char* name, leech::watched<Wide>& config, size_t threads, Read&& read)
+{
+	const size_t reads_per_thread = 2000000;
+	std::atomic<bool> done(false);
+	std::atomic<size_t> sum(0);
+	std::thread reloader([&]() {
+		while (!done.load())
+		{
+			config.reload();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	});
+	std::vector<std::thread> readers;
+	size_t version = config.version();
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i != threads; i++)
+	{
+		readers.emplace_back([&]() {
+			size_t local = 0;
+			read(reads_per_thread, local);
+			sum += local;
+		});
+	}
+	for (std::thread& reader : readers)
+		reader.join();
+	auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+	done = true;
+	reloader.join();
+	std::cout << "{\"backend\":\"watched\",\"case\":\"" << name << "/" << threads
+		<< "\",\"threads\":" << threads << ",\"ops\":" << reads_per_thread * threads
+		<< ",\"ns_per_op\":" << elapsed / reads_per_thread
+		<< ",\"reloads\":" << config.version() - version << ",\"check\":" << sum % 2 << "}" << std::endl;
+}
+
+void bench_watched()
+{
+	const char* filename = "watched_bench.json";
+	{
+		std::ofstream os(filename);
+		Wide v{ };
+		generator gen(1);
+		generate(gen, v, 0);
+		leech::json::document doc;
+		leech::put(doc, v);
+		doc.save(os);
+	}
+	leech::watched<Wide> config(filename, [](const std::string& filename, Wide& v) {
+		leech::json::read_file(filename.c_str(), v);
+	});
+
+	// A shared_ptr behind a mutex, as a reader would use without watched.
+	std::mutex mutex;
+	std::shared_ptr<const Wide> locked = config.snapshot();
+
+	size_t counts[] = { 1, 2, 4, 8, 16 };
+	for (size_t threads : counts)
+	{
+		measure_readers("mutex", config, threads, [&](size_t reads, size_t& local) {
+			for (size_t i = 0; i != reads; i++)
+			{
+				std::shared_ptr<const Wide> snapshot;
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					snapshot = locked;
+				}
+				local += snapshot->i0;
+			}
+		});
+		measure_readers("snapshot", config, threads, [&](size_t reads, size_t& local) {
+			for (size_t i = 0; i != reads; i++)
+				local += config.snapshot()->i0;
+		});
+		measure_readers("reader", config, threads, [&](size_t reads, size_t& local) {
+			leech::watched<Wide>::reader reader(config);
+			for (size_t i = 0; i != reads; i++)
+				local += reader->i0;
+		});
+	}
+	remove(filename);
+}
@@ -0,0 +1,68 @@
+#include "shapes.h"
+#include <leech/yaml.hpp>
+
+struct yaml_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::yaml::document doc{ YAML::Node() };
+		leech::put(doc, v);
+		return doc.save();
+	}
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::yaml::document doc = leech::yaml::load(text);
+		leech::get(doc, v);
+	}
+};
+
+// leech::yaml::emitter_document, which does not build a YAML::Node tree.
+struct yaml_emitter_codec : public yaml_codec
+{
+	template<typename T>
+	static std::string encode(const T& v)
+	{
+		leech::yaml::emitter_document doc;
+		leech::put(doc, v);
+		return doc.str();
+	}
+};
+
+// leech::yaml::read, which decodes from parser events without a YAML::Node tree.
+struct yaml_read_codec : public yaml_emitter_codec
+{
+	template<typename T>
+	static void decode(const std::string& text, T& v)
+	{
+		leech::yaml::read(text, v);
+	}
+};
+
+void bench_yaml()
+{
+	YAML::Node items;
+	for (size_t i = 0; i != sparse_count; i++)
+	{
+		YAML::Node item;
+		item["id"] = i;
+		items.push_back(item);
+	}
+	leech::yaml::document doc(items);
+	throwing_lookup<leech::yaml::document> legacy(doc);
+	Sparse v{ };
+
+	measure("yaml", "sparse/throw", sparse_count, [&]() {
+		for (const auto& item : doc.root())
+			leech::get(legacy, item, v);
+	});
+	measure("yaml", "sparse/has_child", sparse_count, [&]() {
+		for (const auto& item : doc.root())
+			leech::get(doc, item, v);
+	});
+
+	bench_shapes<yaml_codec>("yaml");
+	bench_shapes<yaml_emitter_codec>("yaml-emitter");
+	bench_shapes<yaml_read_codec>("yaml-read");
+}
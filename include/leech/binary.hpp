@@ -0,0 +1,389 @@
+#ifndef _LEECH_BINARY_HPP_
+#define _LEECH_BINARY_HPP_
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+#include <cstdint>
+#include <string.h>
+#include "model.hpp"
+#include "mapped_file.hpp"
+
+namespace leech
+{
+
+namespace binary
+{
+
+	class error : public std::runtime_error
+	{
+	public:
+		explicit error(const char* text) : std::runtime_error(text) { }
+	};
+
+	// Values that are copied as raw bytes: floating point numbers and trivially
+	// copyable types that are neither integers, enums nor reflected structs.
+	template<typename T>
+	struct is_raw : public std::integral_constant<bool,
+		std::is_trivially_copyable<T>::value && !std::is_integral<T>::value && !std::is_enum<T>::value &&
+		!std::is_pointer<T>::value && !is_reflected<T>::value> { };
+
+	// Elements of a sequence that is copied with one memcpy.
+	template<typename T>
+	struct is_bulk : public std::integral_constant<bool,
+		std::is_trivially_copyable<T>::value && !std::is_same<T, bool>::value && !is_reflected<T>::value> { };
+
+	// A compact native encoding that follows the field order of STRUCT_MODEL, so
+	// no names or schema are stored. Integers are varints (zigzag for signed types),
+	// strings and containers are prefixed by their length, and vectors of trivially
+	// copyable elements are copied in bulk. Floating point numbers and bulk data use
+	// the host byte order, so the encoding is meant for caches and IPC on one platform.
+	class document
+	{
+	public:
+		struct element_type { };
+		// Fields are read back in the order they were written, without the skip_write ones.
+		typedef std::true_type positional;
+
+		document() : _data(nullptr), _size(0), _pos(0), _owner(false) { }
+		explicit document(std::string&& data) : _buffer(std::move(data)), _pos(0), _owner(true)
+		{
+			_data = _buffer.data();
+			_size = _buffer.size();
+		}
+		// Reads from memory owned by the caller, which must outlive the document.
+		document(const char* data, size_t size) : _data(data), _size(size), _pos(0), _owner(false) { }
+		// Reads from a mapped file, which the document keeps until it is destroyed.
+		explicit document(mapped_file&& file) : _file(std::move(file)), _pos(0), _owner(false)
+		{
+			_data = _file.data();
+			_size = _file.size();
+		}
+		document(const document&) = delete;
+		document(document&& src) noexcept
+			: _buffer(std::move(src._buffer)), _file(std::move(src._file)), _data(src._data), _size(src._size), _pos(src._pos), _owner(src._owner)
+		{
+			if (_owner) _data = _buffer.data();
+			else if (_file.data()) _data = _file.data();
+		}
+		document& operator=(const document&) = delete;
+		document& operator=(document&& src) noexcept
+		{
+			if (this != &src)
+			{
+				_buffer = std::move(src._buffer);
+				_file = std::move(src._file);
+				_owner = src._owner;
+				_data = _owner ? _buffer.data() : _file.data() ? _file.data() : src._data;
+				_size = src._size;
+				_pos = src._pos;
+			}
+			return *this;
+		}
+
+		const std::string& save() const noexcept { return _buffer; }
+		void save(std::ostream& os) const
+		{
+			os.write(_buffer.data(), _buffer.size());
+		}
+		void save_file(const char* filename) const
+		{
+			std::ofstream fs(filename, std::ios::trunc | std::ios::binary);
+			save(fs);
+			fs.close();
+		}
+		void clear() noexcept
+		{
+			_buffer.clear();
+			_pos = 0;
+		}
+
+		element_type& root() noexcept { return _root; }
+		const element_type& root() const noexcept { return _root; }
+		element_type& child(element_type& element, const char*) const noexcept { return element; }
+		const element_type& child(const element_type& element, const char*) const noexcept { return element; }
+
+		template<typename T>
+		void put(element_type&, const T& v)
+		{
+			write(v);
+		}
+		template<typename T>
+		void get(const element_type&, T& v) const
+		{
+			read(v);
+		}
+
+	private:
+		element_type _root;
+		std::string _buffer;
+		mapped_file _file;
+		const char* _data;
+		size_t _size;
+		mutable size_t _pos;
+		bool _owner;
+
+		void write_varint(std::uint64_t v)
+		{
+			char bytes[10];
+			size_t n = 0;
+			while (v >= 0x80)
+			{
+				bytes[n++] = static_cast<char>(v | 0x80);
+				v >>= 7;
+			}
+			bytes[n++] = static_cast<char>(v);
+			_buffer.append(bytes, n);
+		}
+		std::uint64_t read_varint() const
+		{
+			std::uint64_t v = 0;
+			for (unsigned shift = 0; shift < 64; shift += 7)
+			{
+				if (_pos == _size)
+					throw error("unexpected end of binary data");
+				unsigned char byte = static_cast<unsigned char>(_data[_pos++]);
+				v |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+					return v;
+			}
+			throw error("malformed varint in binary data");
+		}
+		void write_bytes(const void* data, size_t size)
+		{
+			_buffer.append(static_cast<const char*>(data), size);
+		}
+		const char* read_bytes(size_t size) const
+		{
+			if (size > _size - _pos)
+				throw error("unexpected end of binary data");
+			const char* p = _data + _pos;
+			_pos += size;
+			return p;
+		}
+		size_t read_length() const
+		{
+			std::uint64_t length = read_varint();
+			if (length > _size - _pos)
+				throw error("invalid length in binary data");
+			return static_cast<size_t>(length);
+		}
+
+		void write(bool v)
+		{
+			_buffer += static_cast<char>(v ? 1 : 0);
+		}
+		void read(bool& v) const
+		{
+			v = *read_bytes(1) != 0;
+		}
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type write(T v)
+		{
+			std::int64_t n = v;
+			write_varint((static_cast<std::uint64_t>(n) << 1) ^ static_cast<std::uint64_t>(n >> 63));
+		}
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type read(T& v) const
+		{
+			std::uint64_t n = read_varint();
+			v = static_cast<T>(static_cast<std::int64_t>(n >> 1) ^ -static_cast<std::int64_t>(n & 1));
+		}
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type write(T v)
+		{
+			write_varint(v);
+		}
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type read(T& v) const
+		{
+			v = static_cast<T>(read_varint());
+		}
+		template<typename T>
+		typename std::enable_if<std::is_enum<T>::value>::type write(T v)
+		{
+			write(static_cast<typename std::underlying_type<T>::type>(v));
+		}
+		template<typename T>
+		typename std::enable_if<std::is_enum<T>::value>::type read(T& v) const
+		{
+			typename std::underlying_type<T>::type n;
+			read(n);
+			v = static_cast<T>(n);
+		}
+		template<typename T>
+		typename std::enable_if<is_raw<T>::value>::type write(const T& v)
+		{
+			write_bytes(&v, sizeof(T));
+		}
+		template<typename T>
+		typename std::enable_if<is_raw<T>::value>::type read(T& v) const
+		{
+			memcpy(&v, read_bytes(sizeof(T)), sizeof(T));
+		}
+		template<typename T>
+		typename std::enable_if<is_reflected<T>::value>::type write(const T& v)
+		{
+			leech::put(*this, _root, v);
+		}
+		template<typename T>
+		typename std::enable_if<is_reflected<T>::value>::type read(T& v) const
+		{
+			leech::get(*this, _root, v);
+		}
+
+		void write(const std::string& v)
+		{
+			write_varint(v.size());
+			write_bytes(v.data(), v.size());
+		}
+		void read(std::string& v) const
+		{
+			size_t length = read_length();
+			v.assign(read_bytes(length), length);
+		}
+
+		template<typename T>
+		void write(const std::vector<T>& v)
+		{
+			write_sequence(v, is_bulk<T>());
+		}
+		template<typename T>
+		void read(std::vector<T>& v) const
+		{
+			read_vector(v, is_bulk<T>());
+		}
+		void read(std::vector<bool>& v) const
+		{
+			size_t length = read_length();
+			v.resize(length);
+			for (size_t i = 0; i != length; i++)
+				v[i] = *read_bytes(1) != 0;
+		}
+		template<typename T>
+		void write(const std::list<T>& v)
+		{
+			write_sequence(v, std::false_type());
+		}
+		template<typename T>
+		void read(std::list<T>& v) const
+		{
+			size_t length = read_length();
+			v.resize(length);
+			for (auto& item : v)
+				read(item);
+		}
+		template<typename K, typename T>
+		void write(const std::map<K, T>& v)
+		{
+			write_map(v);
+		}
+		template<typename K, typename T>
+		void read(std::map<K, T>& v) const
+		{
+			read_map(v);
+		}
+		template<typename K, typename T>
+		void write(const std::unordered_map<K, T>& v)
+		{
+			write_map(v);
+		}
+		template<typename K, typename T>
+		void read(std::unordered_map<K, T>& v) const
+		{
+			read_map(v);
+		}
+
+		template<typename T>
+		void write_sequence(const std::vector<T>& v, std::true_type)
+		{
+			write_varint(v.size());
+			write_bytes(v.data(), v.size() * sizeof(T));
+		}
+		template<typename Sequence>
+		void write_sequence(const Sequence& v, std::false_type)
+		{
+			write_varint(v.size());
+			for (const auto& item : v)
+				write(item);
+		}
+		template<typename T>
+		void read_vector(std::vector<T>& v, std::true_type) const
+		{
+			size_t length = read_length();
+			if (length > (_size - _pos) / sizeof(T))
+				throw error("invalid length in binary data");
+			v.resize(length);
+			memcpy(v.data(), read_bytes(length * sizeof(T)), length * sizeof(T));
+		}
+		template<typename T>
+		void read_vector(std::vector<T>& v, std::false_type) const
+		{
+			size_t length = read_length();
+			v.resize(length);
+			for (size_t i = 0; i != length; i++)
+				read(v[i]);
+		}
+		template<typename Map>
+		void write_map(const Map& v)
+		{
+			write_varint(v.size());
+			for (const auto& item : v)
+			{
+				write(item.first);
+				write(item.second);
+			}
+		}
+		template<typename Map>
+		void read_map(Map& v) const
+		{
+			size_t length = read_length();
+			v.clear();
+			typename Map::key_type key;
+			for (size_t i = 0; i != length; i++)
+			{
+				read(key);
+				read(v[key]);
+			}
+		}
+	};
+
+	inline document load(std::string&& input)
+	{
+		return document(std::move(input));
+	}
+	inline document load(const std::string& input)
+	{
+		return document(std::string(input));
+	}
+	inline document load(std::istream& input)
+	{
+		std::ostringstream oss;
+		oss << input.rdbuf();
+		return document(oss.str());
+	}
+	inline document load_file(const char* filename, load_stats* stats = nullptr)
+	{
+		load_timer timer(stats);
+		mapped_file file;
+		if (!file.open(filename))
+			throw error("cannot open binary file");
+		timer.io_done();
+		document doc(std::move(file));
+		timer.parse_done();
+		return doc;
+	}
+
+}
+
+}
+
+#endif //_LEECH_BINARY_HPP_
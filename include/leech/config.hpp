@@ -4,6 +4,10 @@
 #pragma once
 
 #include <libconfig.h>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <sstream>
 #include <iomanip>
@@ -11,6 +15,8 @@
 #include <map>
 #include <tuple>
 #include <unordered_map>
+#include "mapped_file.hpp"
+#include "sax.hpp"
 
 namespace leech
 {
@@ -38,6 +44,16 @@ namespace leech
 				}
 			}
 
+			// An error found in file (nullptr if the text was not read from a file) at line.
+			error(const char* file, int line, const std::string& text, config_error_t code = CONFIG_ERR_PARSE) : _error(code)
+			{
+				std::ostringstream oss;
+				if (file) oss << file;
+				if (line) oss << "(" << line << ")";
+				oss << "error(" << _error << "): " << text;
+				_text = oss.str();
+			}
+
 			const char* what() const noexcept override { return _text.data(); }
 			config_error_t code() const noexcept { return _error;  }
 
@@ -102,10 +118,16 @@ namespace leech
 			enum { value = CONFIG_TYPE_STRING };
 		};
 
+		inline constexpr bool is_scalar_type(int type)
+		{
+			return type >= CONFIG_TYPE_INT && type <= CONFIG_TYPE_BOOL;
+		}
+
+		// libconfig arrays only hold scalars of one type, so sequences of aggregates are lists.
 		template<typename T>
 		struct config_type<std::vector<T>>
 		{
-			enum { value = CONFIG_TYPE_ARRAY };
+			enum { value = is_scalar_type(config_type<T>::value) ? CONFIG_TYPE_ARRAY : CONFIG_TYPE_LIST };
 		};
 
 		template<typename T>
@@ -167,7 +189,7 @@ namespace leech
 
 			setting operator[](int index) const
 			{
-				setting(config_setting_get_elem(_setting, index));
+				return setting(config_setting_get_elem(_setting, index));
 			}
 
 			setting operator[](const char* name)
@@ -175,7 +197,10 @@ namespace leech
 				config_setting_t * child = config_setting_get_member(_setting, name);
 				if (child)
 					return setting(child);
-				else if (config_setting_is_group(_setting))
+				// A setting without a value yet becomes the group of a nested structure.
+				if (type() == CONFIG_TYPE_NONE)
+					change(CONFIG_TYPE_GROUP);
+				if (config_setting_is_group(_setting))
 					return setting(config_setting_add(_setting, name, CONFIG_TYPE_NONE));
 				else
 					throw invalid_setting();
@@ -184,6 +209,10 @@ namespace leech
 			{
 				return setting(config_setting_get_member(_setting, name));
 			}
+			bool exists(const char* name) const
+			{
+				return config_setting_get_member(_setting, name) != nullptr;
+			}
 
 			template<typename T>
 			T as() const 
@@ -211,14 +240,14 @@ namespace leech
 				if (type() != CONFIG_TYPE_LIST)
 					throw convert_error("list");
 
-				as_tuple < std::make_index_sequence < std::tuple_size<std::tuple<Types...>>::value> >(v);
+				as_tuple(v, std::index_sequence_for<Types...>());
 				return v;
 			}
 
 			template<typename T>
 			std::vector<T>& as_to(std::vector<T>& v) const
 			{
-				if (type() != CONFIG_TYPE_ARRAY)
+				if (type() != CONFIG_TYPE_ARRAY && type() != CONFIG_TYPE_LIST)
 					throw convert_error("array");
 
 				size_t length = config_setting_length(_setting);
@@ -266,27 +295,23 @@ namespace leech
 			}
 
 			setting& operator=(int value)
-			{				
-				if (type() != CONFIG_TYPE_INT)
-					change(CONFIG_TYPE_INT);
+			{
+				change(CONFIG_TYPE_INT);
 				return verify(config_setting_set_int(_setting, value));
 			}
 			setting& operator=(long long value)
 			{
-				if (type() != CONFIG_TYPE_INT)
-					change(CONFIG_TYPE_INT64);
+				change(CONFIG_TYPE_INT64);
 				return verify(config_setting_set_int64(_setting, value));
 			}
 			setting& operator=(double value)
 			{
-				if (type() != CONFIG_TYPE_INT)
-					change(CONFIG_TYPE_FLOAT);
+				change(CONFIG_TYPE_FLOAT);
 				return verify(config_setting_set_float(_setting, value));
 			}
 			setting& operator=(bool value)
 			{
-				if (type() != CONFIG_TYPE_INT)
-					change(CONFIG_TYPE_BOOL);
+				change(CONFIG_TYPE_BOOL);
 				return verify(config_setting_set_bool(_setting, value));
 			}
 			setting& operator=(const char* value)
@@ -298,16 +323,19 @@ namespace leech
 			{
 				return *this = value.data();
 			}
+			// Aggregates are written in one pass: the elements already there are reused
+			// while their type (and name, in a group) matches, and the rest are replaced.
 			template<typename T>
 			setting& operator=(const std::vector<T>& value)
 			{
-				change(CONFIG_TYPE_ARRAY);
-				clear();
-				for (const auto& item : value)
+				change(config_type<std::vector<T>>::value);
+				int index = 0;
+				for (auto it = value.begin(); it != value.end(); ++it)
 				{
-					setting element(config_setting_add(_setting, NULL, config_type<T>::value));
-					leech::config::assign<T>()(element, item);
+					setting element = next_element(index, config_type<T>::value);
+					leech::config::assign<T>()(element, *it);
 				}
+				truncate(index);
 				return *this;
 			}
 
@@ -315,49 +343,38 @@ namespace leech
 			setting& operator=(const std::pair<T1, T2>& value)
 			{
 				change(CONFIG_TYPE_LIST);
-				clear();
-				assign_tuple < std::make_index_sequence < std::tuple_size<std::pair<T1, T2>>::value> >(value);
+				int index = 0;
+				setting first = next_element(index, config_type<T1>::value);
+				leech::config::assign<T1>()(first, value.first);
+				setting second = next_element(index, config_type<T2>::value);
+				leech::config::assign<T2>()(second, value.second);
+				truncate(index);
 				return *this;
 			}
 			template<typename... Types>
 			setting& operator=(const std::tuple<Types...>& value)
 			{
 				change(CONFIG_TYPE_LIST);
-				clear();
-				assign_tuple < std::make_index_sequence < std::tuple_size<std::tuple<Types...>>::value> > (value);
+				int index = 0;
+				assign_tuple(value, index, std::index_sequence_for<Types...>());
+				truncate(index);
 				return *this;
 			}
 
 			template<typename T>
 			setting& operator=(const std::map<std::string, T>& value)
 			{
-				change(CONFIG_TYPE_GROUP);
-				clear();
-				for (const auto& item : value)
-				{
-					setting element(config_setting_add(_setting, item.first, config_type<T>::value));
-					leech::config::assign<T>()(element, item.second);
-				}
-				return *this;
+				return assign_group(value);
 			}
 			template<typename T>
 			setting& operator=(const std::unordered_map<std::string, T>& value)
 			{
-				change(CONFIG_TYPE_GROUP);
-				clear();
-				for (const auto& item : value)
-				{
-					setting element(config_setting_add(_setting, item.first, config_type<T>::value));
-					leech::config::assign<T>()(element, item.second);
-				}
-				return *this;
+				return assign_group(value);
 			}
 
 			void clear()
 			{
-				int count = config_setting_length(_setting);
-				for (int i = 0; i != count; i++)
-					verify(config_setting_remove_elem(_setting, i));
+				truncate(0);
 			}
 
 		private:
@@ -373,12 +390,13 @@ namespace leech
 			{
 				if (this->type() != type)
 				{
-					config_setting_t* parent = config_setting_parent(_setting);
-					if (parent)
+					if (this->type() == CONFIG_TYPE_NONE && is_scalar_type(type))
+					{
+						// The setters of libconfig give a setting without a value their own type.
+					}
+					else if (config_setting_parent(_setting))
 					{
-						std::string name = this->name();
-						config_setting_remove(parent, name.data());
-						config_setting_add(parent, name.data(), type);
+						replace(type);
 					}
 					else
 					{
@@ -396,42 +414,137 @@ namespace leech
 					}
 				}
 			}
+			// Replaces the setting with an empty one of another type at the same position.
+			// libconfig only appends, so the settings after it are moved out and back behind it.
+			void replace(int type)
+			{
+				config_setting_t* parent = config_setting_parent(_setting);
+				int index = config_setting_index(_setting);
+				std::string name = this->name() ? this->name() : "";
+				scratch_config tail;
+				config_setting_t* holder = config_root_setting(&tail.config);
+				if (!config_setting_is_group(parent))
+					holder = config_setting_add(holder, "tail", CONFIG_TYPE_LIST);
+				int length = config_setting_length(parent);
+				for (int i = index + 1; i < length; i++)
+					copy_setting(config_setting_get_elem(parent, i), holder);
+				for (int i = length; i-- > index; )
+					verify_in(parent, config_setting_remove_elem(parent, i));
+				_setting = config_setting_add(parent, name.empty() ? NULL : name.c_str(), type);
+				if (_setting == nullptr)
+					throw invalid_setting();
+				for (int i = 0, count = config_setting_length(holder); i != count; i++)
+					copy_setting(config_setting_get_elem(holder, i), parent);
+			}
+			// A config_t that only holds settings while they are moved.
+			struct scratch_config
+			{
+				config_t config;
+				scratch_config() { config_init(&config); }
+				~scratch_config() { config_destroy(&config); }
+				scratch_config(const scratch_config&) = delete;
+				scratch_config& operator=(const scratch_config&) = delete;
+			};
+			static void verify_in(config_setting_t* setting, int code)
+			{
+				if (code == CONFIG_FALSE)
+					throw error(*setting->config);
+			}
+			// Appends a deep copy of from to parent, through the public API of libconfig.
+			static void copy_setting(const config_setting_t* from, config_setting_t* parent)
+			{
+				int type = config_setting_type(from);
+				config_setting_t* to = config_setting_add(parent, config_setting_is_group(parent) ? config_setting_name(from) : NULL, type);
+				if (to == nullptr)
+					throw invalid_setting();
+				config_setting_set_format(to, config_setting_get_format(from));
+				switch (type)
+				{
+				case CONFIG_TYPE_INT: verify_in(to, config_setting_set_int(to, config_setting_get_int(from))); break;
+				case CONFIG_TYPE_INT64: verify_in(to, config_setting_set_int64(to, config_setting_get_int64(from))); break;
+				case CONFIG_TYPE_FLOAT: verify_in(to, config_setting_set_float(to, config_setting_get_float(from))); break;
+				case CONFIG_TYPE_BOOL: verify_in(to, config_setting_set_bool(to, config_setting_get_bool(from))); break;
+				case CONFIG_TYPE_STRING: verify_in(to, config_setting_set_string(to, config_setting_get_string(from))); break;
+				case CONFIG_TYPE_GROUP:
+				case CONFIG_TYPE_ARRAY:
+				case CONFIG_TYPE_LIST:
+					for (int i = 0, count = config_setting_length(from); i != count; i++)
+						copy_setting(config_setting_get_elem(from, i), to);
+					break;
+				default:
+					break;
+				}
+			}
 
-			template<typename Tuple, size_t I>
-			void assign_tuple_impl(const Tuple& value)
+			// The element at index, reused if it has the type, and the index of the next one.
+			setting next_element(int& index, int type)
 			{
-				typedef typename std::tuple_element<I, Tuple>::value value_type;
-				setting element(config_setting_add(_setting, NULL, config_type<value_type>()));
-				leech::config::assign<value_type>()(element, std::get<I>(value));
+				if (index < config_setting_length(_setting))
+				{
+					config_setting_t* element = config_setting_get_elem(_setting, index);
+					if (config_setting_type(element) == type)
+					{
+						++index;
+						return setting(element);
+					}
+					truncate(index);
+				}
+				++index;
+				return setting(config_setting_add(_setting, NULL, type));
 			}
-			template<typename Tuple, size_t I, size_t... Other>
-			void assign_tuple_impl(const Tuple& value)
+			// Removes the elements from index on, last first so that nothing moves.
+			void truncate(int index)
 			{
-				assign_tuple_impl<I>(value);
-				assign_tuple_impl<Other...>(value);
+				for (int i = config_setting_length(_setting); i-- > index; )
+					verify(config_setting_remove_elem(_setting, i));
 			}
-			template<typename Tuple, size_t I>
-			void as_tuple_impl(Tuple& value)
+			template<typename Map>
+			setting& assign_group(const Map& value)
 			{
-				typedef typename std::tuple_element<I, Tuple>::value value_type;
-				setting element(config_setting_get_elem(_setting, I));
-				leech::config::as_to<value_type>()(element, std::get<I>(value));
+				typedef typename Map::mapped_type value_type;
+				change(CONFIG_TYPE_GROUP);
+				int index = 0;
+				for (const auto& item : value)
+				{
+					config_setting_t* element = nullptr;
+					if (index < config_setting_length(_setting))
+					{
+						element = config_setting_get_elem(_setting, index);
+						if (config_setting_type(element) != config_type<value_type>::value || strcmp(config_setting_name(element), item.first.c_str()) != 0)
+						{
+							truncate(index);
+							element = nullptr;
+						}
+					}
+					if (element == nullptr)
+						element = config_setting_add(_setting, item.first.c_str(), config_type<value_type>::value);
+					setting member(element);
+					leech::config::assign<value_type>()(member, item.second);
+					++index;
+				}
+				truncate(index);
+				return *this;
 			}
-			template<typename Tuple, size_t I, size_t... Other>
-			void as_tuple_impl(Tuple& value)
+
+			template<typename Tuple, std::size_t... Is>
+			void assign_tuple(const Tuple& value, int& index, std::index_sequence<Is...>)
 			{
-				as_tuple_impl<I>(value);
-				as_tuple_impl<Other...>(value);
+				int expand[] = { 0, (assign_tuple_element<Is>(value, index), 0)... };
+				(void)expand;
 			}
-			template<typename Tuples, std::size_t... Is>
-			void assign_tuple(const Tuples& value, std::index_sequence<Is...>)
+			template<size_t I, typename Tuple>
+			void assign_tuple_element(const Tuple& value, int& index)
 			{
-				assign_tuple_impl<Is...>(value);
+				typedef typename std::tuple_element<I, Tuple>::type value_type;
+				setting element = next_element(index, config_type<value_type>::value);
+				leech::config::assign<value_type>()(element, std::get<I>(value));
 			}
-			template<typename Tuples, std::size_t... Is>
-			void as_tuple(const Tuples& value, std::index_sequence<Is...>)
+			template<typename Tuple, std::size_t... Is>
+			void as_tuple(Tuple& value, std::index_sequence<Is...>) const
 			{
-				as_tuple_impl<Is...>(value);
+				int expand[] = { 0, (leech::config::as_to<typename std::tuple_element<Is, Tuple>::type>()(
+					setting(config_setting_get_elem(_setting, Is)), std::get<Is>(value)), 0)... };
+				(void)expand;
 			}
 		};
 
@@ -588,6 +701,22 @@ namespace leech
 			{
 				return element[name];
 			}
+			bool has_child(const element_type& element, const char* name) const
+			{
+				return element.exists(name);
+			}
+			// Calls fn(name, child) for each member of a group, in file order.
+			template<typename Fn>
+			void for_each_child(const element_type& element, Fn&& fn) const
+			{
+				if (element.type() != CONFIG_TYPE_GROUP) return;
+				int count = static_cast<int>(element.size());
+				for (int i = 0; i != count; i++)
+				{
+					setting child = element[i];
+					fn(child.name(), child);
+				}
+			}
 
 			template<typename T>
 			void put(element_type& element, const T& v) const
@@ -618,9 +747,14 @@ namespace leech
 			{
 				verify(config_read(&_config, input));
 			}
-			void load_file(const char* filename)
+			// libconfig reads the file itself so that @include and error messages keep the
+			// file name; stats only reports the total time, as parse.
+			void load_file(const char* filename, load_stats* stats = nullptr)
 			{
+				load_timer timer(stats);
+				timer.io_done();
 				verify(config_read_file(&_config, filename));
+				timer.parse_done();
 			}
 
 		private:
@@ -659,6 +793,372 @@ namespace leech
 			}
 		};
 
+		// Parses libconfig text straight into a leech::sax::decoder, without building a
+		// config_setting_t tree. It reads groups, arrays, lists, scalars and @include
+		// directives; errors carry the file and line, like the ones of libconfig.
+		class reader
+		{
+		public:
+			template<typename T>
+			explicit reader(T& v) : _decoder(v), _input{ nullptr, nullptr, nullptr, 0 }, _depth(0) { }
+
+			template<typename T>
+			void reset(T& v) { _decoder.reset(v); }
+
+			// Where relative @include paths are looked up, as config_set_include_dir.
+			void include_dir(const char* path) { _include_dir = path ? path : ""; }
+			const std::string& include_dir() const noexcept { return _include_dir; }
+
+			void parse(const char* first, const char* last, const char* filename = nullptr)
+			{
+				source_scope scope(_input, source{ first, last, filename, 1 });
+				_depth = 0;
+				try
+				{
+					_decoder.start_object();
+					settings(0);
+					_decoder.end_object();
+				}
+				catch (const sax::error& e)
+				{
+					fail(e.what());
+				}
+			}
+			void parse_file(const char* filename, load_stats* stats = nullptr)
+			{
+				load_timer timer(stats);
+				mapped_file file;
+				if (!file.open(filename))
+					throw error(nullptr, 0, std::string("cannot open file ") + filename, CONFIG_ERR_FILE_IO);
+				timer.io_done();
+				parse(file.begin(), file.end(), filename);
+				timer.parse_done();
+			}
+
+		private:
+			struct source
+			{
+				const char* p;
+				const char* last;
+				const char* file;
+				int line;
+			};
+			// Makes a source current and restores the previous one however parsing ends.
+			class source_scope
+			{
+			public:
+				source_scope(source& current, const source& input) noexcept : _current(current), _saved(current) { _current = input; }
+				~source_scope() { _current = _saved; }
+
+			private:
+				source& _current;
+				source _saved;
+			};
+
+			sax::decoder _decoder;
+			source _input;
+			std::string _include_dir;
+			std::string _text;
+			int _depth;
+
+			[[noreturn]] void fail(const std::string& text) const
+			{
+				throw error(_input.file, _input.line, text);
+			}
+			bool at_end() const noexcept { return _input.p == _input.last; }
+
+			// Skips white space and the three kinds of comments, counting lines.
+			void skip()
+			{
+				const char*& p = _input.p;
+				const char* last = _input.last;
+				while (p != last)
+				{
+					if (*p == '\n')
+						++_input.line;
+					else if (*p == '#' || (*p == '/' && p + 1 != last && p[1] == '/'))
+					{
+						while (p != last && *p != '\n') ++p;
+						continue;
+					}
+					else if (*p == '/' && p + 1 != last && p[1] == '*')
+					{
+						for (p += 2; p != last && !(*p == '*' && p + 1 != last && p[1] == '/'); ++p)
+						{
+							if (*p == '\n') ++_input.line;
+						}
+						if (p == last)
+							fail("unterminated comment");
+						p += 2;
+						continue;
+					}
+					else if (*p != ' ' && *p != '\t' && *p != '\r' && *p != '\f')
+						break;
+					++p;
+				}
+			}
+
+			// The settings of a group up to close, or up to the end of the input if close is 0.
+			void settings(char close)
+			{
+				for (;;)
+				{
+					skip();
+					if (at_end())
+					{
+						if (close) fail("unexpected end of file");
+						return;
+					}
+					if (*_input.p == close)
+					{
+						++_input.p;
+						return;
+					}
+					if (*_input.p == '@')
+					{
+						include();
+						continue;
+					}
+					name();
+					skip();
+					if (at_end() || (*_input.p != '=' && *_input.p != ':'))
+						fail("expected '=' or ':' after the setting name");
+					++_input.p;
+					_decoder.key(_text);
+					value();
+					skip();
+					if (!at_end() && (*_input.p == ';' || *_input.p == ','))
+						++_input.p;
+				}
+			}
+			void name()
+			{
+				const char* first = _input.p;
+				const char*& p = _input.p;
+				if (!isalpha(static_cast<unsigned char>(*p)) && *p != '*')
+					fail("syntax error");
+				for (++p; p != _input.last && (isalnum(static_cast<unsigned char>(*p)) || *p == '-' || *p == '_' || *p == '*'); ++p) { }
+				_text.assign(first, p);
+			}
+			void value()
+			{
+				skip();
+				if (at_end())
+					fail("unexpected end of file");
+				switch (*_input.p)
+				{
+				case '{':
+					++_input.p;
+					_decoder.start_object();
+					settings('}');
+					_decoder.end_object();
+					break;
+				case '[':
+				case '(':
+					elements(*_input.p == '[' ? ']' : ')');
+					break;
+				case '"':
+					string();
+					_decoder.string(_text);
+					break;
+				default:
+					scalar();
+					break;
+				}
+			}
+			// An array, which only holds scalars, or a list; a trailing comma is allowed.
+			void elements(char close)
+			{
+				++_input.p;
+				_decoder.start_array();
+				for (;;)
+				{
+					skip();
+					if (at_end())
+						fail("unexpected end of file");
+					if (*_input.p == close)
+						break;
+					if (close == ']' && (*_input.p == '{' || *_input.p == '[' || *_input.p == '('))
+						fail("an array can only hold scalar values");
+					value();
+					skip();
+					if (at_end())
+						fail("unexpected end of file");
+					if (*_input.p == ',')
+						++_input.p;
+					else if (*_input.p != close)
+						fail(std::string("expected ',' or '") + close + "'");
+				}
+				++_input.p;
+				_decoder.end_array();
+			}
+			// A quoted string, joined with the strings that directly follow it.
+			void string()
+			{
+				_text.clear();
+				do
+				{
+					quoted();
+					skip();
+				} while (!at_end() && *_input.p == '"');
+			}
+			// Appends one quoted string to _text and stops after its closing quote.
+			void quoted()
+			{
+				const char*& p = _input.p;
+				for (++p; p != _input.last && *p != '"'; ++p)
+				{
+					if (*p == '\n') ++_input.line;
+					if (*p != '\\')
+					{
+						_text += *p;
+						continue;
+					}
+					if (++p == _input.last) break;
+					switch (*p)
+					{
+					case '\\': _text += '\\'; break;
+					case '"': _text += '"'; break;
+					case 'f': _text += '\f'; break;
+					case 'n': _text += '\n'; break;
+					case 'r': _text += '\r'; break;
+					case 't': _text += '\t'; break;
+					case 'x':
+						if (_input.last - p < 3 || !isxdigit(static_cast<unsigned char>(p[1])) || !isxdigit(static_cast<unsigned char>(p[2])))
+							fail("invalid escape in string");
+						_text += static_cast<char>(std::stoi(std::string(p + 1, 2), nullptr, 16));
+						p += 2;
+						break;
+					default:
+						fail("invalid escape in string");
+					}
+				}
+				if (p == _input.last)
+					fail("unterminated string");
+				++p;
+			}
+			// A boolean or a number: decimal, hexadecimal (0x), binary (0b) or octal (0o)
+			// integers with an optional L suffix, and floating point numbers.
+			void scalar()
+			{
+				const char* first = _input.p;
+				const char*& p = _input.p;
+				while (p != _input.last && (isalnum(static_cast<unsigned char>(*p)) || *p == '+' || *p == '-' || *p == '.')) ++p;
+				_text.assign(first, p);
+				if (_text.empty())
+					fail("syntax error");
+				if (is_word("true"))
+					return _decoder.boolean(true);
+				if (is_word("false"))
+					return _decoder.boolean(false);
+
+				size_t end = _text.size();
+				while (end && (_text[end - 1] == 'L' || _text[end - 1] == 'l')) --end;
+				size_t digits = _text[0] == '-' || _text[0] == '+' ? 1 : 0;
+				int base = 10;
+				if (end - digits > 2 && _text[digits] == '0')
+				{
+					char prefix = static_cast<char>(tolower(static_cast<unsigned char>(_text[digits + 1])));
+					base = prefix == 'x' ? 16 : prefix == 'b' ? 2 : prefix == 'o' ? 8 : 10;
+				}
+				if (base != 10)
+				{
+					char* last;
+					unsigned long long v = strtoull(_text.c_str() + digits + 2, &last, base);
+					if (last != _text.c_str() + end)
+						fail("invalid number");
+					if (_text[0] == '-')
+						_decoder.integer(-static_cast<long long>(v));
+					else
+						_decoder.integer(static_cast<long long>(v));
+					return;
+				}
+				char* last;
+				if (end == _text.size() && _text.find_first_of(".eE") != std::string::npos)
+				{
+					double v = strtod(_text.c_str(), &last);
+					if (last != _text.c_str() + end)
+						fail("invalid number");
+					_decoder.floating(v);
+					return;
+				}
+				errno = 0;
+				long long v = strtoll(_text.c_str(), &last, 10);
+				if (last != _text.c_str() + end || end == digits || errno == ERANGE)
+					fail("invalid number");
+				_decoder.integer(v);
+			}
+			// Booleans are not case sensitive.
+			bool is_word(const char* word) const noexcept
+			{
+				size_t i = 0;
+				for (; i != _text.size() && word[i]; i++)
+				{
+					if (tolower(static_cast<unsigned char>(_text[i])) != word[i])
+						return false;
+				}
+				return i == _text.size() && word[i] == 0;
+			}
+			// @include "file": the settings of the file take the place of the directive.
+			void include()
+			{
+				++_input.p;
+				const char* first = _input.p;
+				while (!at_end() && isalpha(static_cast<unsigned char>(*_input.p))) ++_input.p;
+				if (std::string(first, _input.p) != "include")
+					fail("unknown directive");
+				skip();
+				if (at_end() || *_input.p != '"')
+					fail("expected a file name after @include");
+				// Only one string, so the line of the directive is still current.
+				_text.clear();
+				quoted();
+				if (++_depth > 10)
+					fail("include file nesting too deep");
+				std::string path = _text;
+				if (!_include_dir.empty() && path[0] != '/')
+					path = _include_dir + '/' + path;
+				mapped_file file;
+				if (!file.open(path.c_str()))
+					throw error(_input.file, _input.line, "cannot open include file " + path, CONFIG_ERR_FILE_IO);
+				// Errors of the decoder are reported while the included file is still the current one.
+				source_scope scope(_input, source{ file.begin(), file.end(), path.c_str(), 1 });
+				try
+				{
+					settings(0);
+				}
+				catch (const sax::error& e)
+				{
+					fail(e.what());
+				}
+				--_depth;
+			}
+		};
+
+		// Decodes libconfig text directly into v, without building a config_setting_t tree.
+		template<typename T>
+		inline void read(const char* first, const char* last, T& v)
+		{
+			reader handler(v);
+			handler.parse(first, last);
+		}
+		template<typename T>
+		inline void read(const char* input, T& v)
+		{
+			read(input, input + strlen(input), v);
+		}
+		template<typename T>
+		inline void read(const std::string& input, T& v)
+		{
+			read(input.data(), input.data() + input.size(), v);
+		}
+		template<typename T>
+		inline void read_file(const char* filename, T& v, load_stats* stats = nullptr)
+		{
+			reader handler(v);
+			handler.parse_file(filename, stats);
+		}
+
 	}
 
 }
@@ -0,0 +1,347 @@
+#ifndef _LEECH_DELTA_HPP_
+#define _LEECH_DELTA_HPP_
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <type_traits>
+#include "model.hpp"
+
+namespace leech
+{
+
+	// What changed between two values: the changed fields of a reflected struct, with the
+	// changes inside each of them, and the entries of a map that were added, changed or
+	// removed. Any other value that changed is replaced as a whole.
+	struct change_set
+	{
+		// Changed fields, by index in field_table.
+		std::vector<std::pair<size_t, change_set>> fields;
+		// Map entries that are written whole: added, or changed and not reflected.
+		std::vector<std::string> set;
+		// Reflected map entries that changed, with their changes.
+		std::vector<std::pair<std::string, change_set>> update;
+		std::vector<std::string> removed;
+
+		bool empty() const noexcept
+		{
+			return fields.empty() && set.empty() && update.empty() && removed.empty();
+		}
+	};
+
+	// The changes that turn one S into another. It refers to the new value, which must
+	// outlive it; put_delta writes only what changed.
+	template<typename S>
+	class delta
+	{
+	public:
+		delta(const S& target, change_set&& changes) noexcept : _target(&target), _changes(std::move(changes)) { }
+
+		bool empty() const noexcept { return _changes.empty(); }
+		const S& target() const noexcept { return *_target; }
+		const change_set& changes() const noexcept { return _changes; }
+
+	private:
+		const S* _target;
+		change_set _changes;
+	};
+
+	template<typename T>
+	inline bool equal(const T& a, const T& b);
+
+namespace detail
+{
+	template<typename T>
+	struct is_string_map : public std::false_type { };
+
+	template<typename T, typename Compare, typename Allocator>
+	struct is_string_map<std::map<std::string, T, Compare, Allocator>> : public std::true_type { };
+
+	template<typename T, typename Hash, typename Equal, typename Allocator>
+	struct is_string_map<std::unordered_map<std::string, T, Hash, Equal, Allocator>> : public std::true_type { };
+
+	template<typename T>
+	inline typename std::enable_if<!is_reflected<T>::value>::type equal_value(const T& a, const T& b, bool& result)
+	{
+		result = a == b;
+	}
+
+	template<typename T>
+	inline typename std::enable_if<is_reflected<T>::value>::type equal_value(const T& a, const T& b, bool& result)
+	{
+		result = true;
+		for_each_field<T>([&](const auto& field) {
+			if (result)
+				result = leech::equal(field.get_value(a), field.get_value(b));
+		});
+	}
+
+	template<typename Sequence>
+	inline void equal_sequence(const Sequence& a, const Sequence& b, bool& result)
+	{
+		result = a.size() == b.size();
+		for (auto i = a.begin(), j = b.begin(); result && i != a.end(); ++i, ++j)
+			result = leech::equal(*i, *j);
+	}
+
+	template<typename T, typename Allocator>
+	inline void equal_value(const std::vector<T, Allocator>& a, const std::vector<T, Allocator>& b, bool& result)
+	{
+		equal_sequence(a, b, result);
+	}
+
+	template<typename T, typename Allocator>
+	inline void equal_value(const std::list<T, Allocator>& a, const std::list<T, Allocator>& b, bool& result)
+	{
+		equal_sequence(a, b, result);
+	}
+
+	template<typename Map>
+	inline void equal_map(const Map& a, const Map& b, bool& result)
+	{
+		result = a.size() == b.size();
+		for (auto i = a.begin(); result && i != a.end(); ++i)
+		{
+			auto j = b.find(i->first);
+			result = j != b.end() && leech::equal(i->second, j->second);
+		}
+	}
+
+	template<typename K, typename T, typename Compare, typename Allocator>
+	inline void equal_value(const std::map<K, T, Compare, Allocator>& a, const std::map<K, T, Compare, Allocator>& b, bool& result)
+	{
+		equal_map(a, b, result);
+	}
+
+	template<typename K, typename T, typename Hash, typename Equal, typename Allocator>
+	inline void equal_value(const std::unordered_map<K, T, Hash, Equal, Allocator>& a, const std::unordered_map<K, T, Hash, Equal, Allocator>& b, bool& result)
+	{
+		equal_map(a, b, result);
+	}
+
+	template<typename Map>
+	inline typename std::enable_if<is_string_map<Map>::value, bool>::type diff_value(const Map& a, const Map& b, change_set& changes);
+
+	template<typename Document, typename Map>
+	inline typename std::enable_if<is_string_map<Map>::value>::type put_changes(Document& doc, typename Document::element_type& element, const Map& v, const change_set& changes);
+
+	template<typename Document, typename Map>
+	inline typename std::enable_if<is_string_map<Map>::value>::type apply_changes(const Document& doc, const typename Document::element_type& element, Map& v);
+
+	// diff_value fills the changes from a to b and returns whether there are any.
+	template<typename T>
+	inline typename std::enable_if<!is_reflected<T>::value && !is_string_map<T>::value, bool>::type diff_value(const T& a, const T& b, change_set&)
+	{
+		return !leech::equal(a, b);
+	}
+
+	template<typename T>
+	inline typename std::enable_if<is_reflected<T>::value, bool>::type diff_value(const T& a, const T& b, change_set& changes)
+	{
+		size_t index = 0;
+		for_each_field<T>([&](const auto& field) {
+			change_set inner;
+			if (diff_value(field.get_value(a), field.get_value(b), inner))
+				changes.fields.emplace_back(index, std::move(inner));
+			++index;
+		});
+		return !changes.fields.empty();
+	}
+
+	template<typename Map>
+	inline typename std::enable_if<is_string_map<Map>::value, bool>::type diff_value(const Map& a, const Map& b, change_set& changes)
+	{
+		for (const auto& item : b)
+		{
+			auto found = a.find(item.first);
+			if (found == a.end())
+			{
+				changes.set.push_back(item.first);
+				continue;
+			}
+			change_set inner;
+			if (diff_value(found->second, item.second, inner))
+			{
+				if (is_reflected<typename Map::mapped_type>::value)
+					changes.update.emplace_back(item.first, std::move(inner));
+				else
+					changes.set.push_back(item.first);
+			}
+		}
+		for (const auto& item : a)
+		{
+			if (b.find(item.first) == b.end())
+				changes.removed.push_back(item.first);
+		}
+		return !changes.empty();
+	}
+
+	template<typename Document, typename T>
+	inline typename std::enable_if<!is_reflected<T>::value && !is_string_map<T>::value>::type put_changes(Document& doc, typename Document::element_type& element, const T& v, const change_set&)
+	{
+		leech::put(doc, element, v);
+	}
+
+	template<typename Document, typename T>
+	inline typename std::enable_if<is_reflected<T>::value>::type put_changes(Document& doc, typename Document::element_type& element, const T& v, const change_set& changes)
+	{
+		const auto& table = field_table<T>;
+		for (const auto& item : changes.fields)
+		{
+			if (table[item.first].flags & field_skip_write)
+				continue;
+			struct_info<T>::instance().find_field(item.first, [&](const auto& field) {
+				auto&& child = doc.child(element, field.name());
+				put_changes(doc, child, field.get_value(v), item.second);
+			});
+		}
+	}
+
+	template<typename Document, typename Map>
+	inline typename std::enable_if<is_string_map<Map>::value>::type put_changes(Document& doc, typename Document::element_type& element, const Map& v, const change_set& changes)
+	{
+		if (!changes.set.empty())
+		{
+			auto&& set = doc.child(element, "set");
+			for (const std::string& key : changes.set)
+			{
+				auto&& child = doc.child(set, key.c_str());
+				leech::put(doc, child, v.at(key));
+			}
+		}
+		if (!changes.update.empty())
+		{
+			auto&& update = doc.child(element, "update");
+			for (const auto& item : changes.update)
+			{
+				auto&& child = doc.child(update, item.first.c_str());
+				put_changes(doc, child, v.at(item.first), item.second);
+			}
+		}
+		if (!changes.removed.empty())
+		{
+			auto&& removed = doc.child(element, "removed");
+			leech::put(doc, removed, changes.removed);
+		}
+	}
+
+	template<typename Document, typename T>
+	inline typename std::enable_if<!is_reflected<T>::value && !is_string_map<T>::value>::type apply_changes(const Document& doc, const typename Document::element_type& element, T& v)
+	{
+		leech::get(doc, element, v);
+	}
+
+	template<typename Document, typename T>
+	inline typename std::enable_if<is_reflected<T>::value>::type apply_changes(const Document& doc, const typename Document::element_type& element, T& v);
+
+	template<typename Document, typename Map>
+	inline typename std::enable_if<is_string_map<Map>::value>::type apply_changes(const Document& doc, const typename Document::element_type& element, Map& v)
+	{
+		doc.for_each_child(element, [&](const char* name, const typename Document::element_type& child) {
+			if (strcmp(name, "set") == 0)
+			{
+				doc.for_each_child(child, [&](const char* key, const typename Document::element_type& value) {
+					typename Map::mapped_type entry{ };
+					leech::get(doc, value, entry);
+					v[key] = std::move(entry);
+				});
+			}
+			else if (strcmp(name, "update") == 0)
+			{
+				doc.for_each_child(child, [&](const char* key, const typename Document::element_type& value) {
+					apply_changes(doc, value, v[key]);
+				});
+			}
+			else if (strcmp(name, "removed") == 0)
+			{
+				std::vector<std::string> removed;
+				leech::get(doc, child, removed);
+				for (const std::string& key : removed)
+					v.erase(key);
+			}
+		});
+	}
+
+	// Fields read through setters are replaced as a whole.
+	template<typename Document, typename S, typename Field>
+	inline void apply_field(const Document& doc, const typename Document::element_type& child, const Field& field, S& v)
+	{
+		field.get_child(doc, child, v);
+	}
+
+	template<typename Document, typename S, typename T, typename M, typename A>
+	inline void apply_field(const Document& doc, const typename Document::element_type& child, const struct_data_field<T, M, A>& field, S& v)
+	{
+		apply_changes(doc, child, field.get_value(static_cast<T&>(v)));
+	}
+
+	template<typename Document, typename T>
+	inline typename std::enable_if<is_reflected<T>::value>::type apply_changes(const Document& doc, const typename Document::element_type& element, T& v)
+	{
+		doc.for_each_child(element, [&](const char* name, const typename Document::element_type& child) {
+			struct_info<T>::instance().find_field(name, [&](const auto& field) {
+				apply_field(doc, child, field, v);
+			});
+		});
+	}
+}
+
+	// Compares two values field by field, for reflected structs without operator==;
+	// sequences and maps compare their elements the same way.
+	template<typename T>
+	inline bool equal(const T& a, const T& b)
+	{
+		bool result;
+		detail::equal_value(a, b, result);
+		return result;
+	}
+
+	// The fields of b that differ from a, recursing into reflected fields and into
+	// maps with string keys. Sequences and other values that differ are replaced whole.
+	template<typename S>
+	inline delta<S> diff(const S& a, const S& b)
+	{
+		static_assert(is_reflected<S>::value, "diff needs a reflected type");
+		change_set changes;
+		detail::diff_value(a, b, changes);
+		return delta<S>(b, std::move(changes));
+	}
+
+	// Writes only the changes: changed fields, nested the same way, and for a changed map
+	// an object with the entries to set, the entries to update and the removed keys.
+	template<typename Document, typename S>
+	inline Document& put_delta(Document& doc, typename Document::element_type& element, const delta<S>& d)
+	{
+		detail::put_changes(doc, element, d.target(), d.changes());
+		return doc;
+	}
+
+	template<typename Document, typename S>
+	inline Document& put_delta(Document&& doc, const delta<S>& d)
+	{
+		return put_delta(doc, doc.root(), d);
+	}
+
+	// Applies a delta written by put_delta to v. It walks the members of the delta,
+	// so the document needs the for_each_child hook.
+	template<typename Document, typename S>
+	inline void apply_delta(const Document& doc, const typename Document::element_type& element, S& v)
+	{
+		static_assert(detail::for_each_child_hook<Document>::value, "apply_delta needs a document with for_each_child");
+		detail::apply_changes(doc, element, v);
+	}
+
+	template<typename Document, typename S>
+	inline void apply_delta(const Document& doc, S& v)
+	{
+		apply_delta(doc, doc.root(), v);
+	}
+
+}
+
+#endif //_LEECH_DELTA_HPP_
@@ -9,6 +9,8 @@
 #include <unordered_map>
 #include <boost/property_tree/info_parser.hpp>
 #include <boost/property_tree/ptree.hpp>
+#include "mapped_file.hpp"
+#include "model.hpp"
 
 namespace leech
 {
@@ -64,9 +66,24 @@ public:
 	{
 		return element.get_child(name);
 	}
+	// Finds the child to write into, or adds it at the end.
 	element_type& child(element_type& element, const char* name) const
 	{
-		return element.get_child(name);
+		auto it = element.find(name);
+		if (it != element.not_found())
+			return it->second;
+		return element.push_back(std::make_pair(name, element_type()))->second;
+	}
+	bool has_child(const element_type& element, const char* name) const
+	{
+		return element.find(name) != element.not_found();
+	}
+	// Calls fn(name, child) for each child of a node, in document order.
+	template<typename Fn>
+	void for_each_child(const element_type& element, Fn&& fn) const
+	{
+		for (const auto& item : element)
+			fn(item.first.c_str(), item.second);
 	}
 
 	template<typename T>
@@ -74,38 +91,26 @@ public:
 	{
 		element.put_value(v);
 	}
+	// Containers add each child in place and write into it, nothing is copied.
 	template<typename T>
 	void put(element_type& element, const std::vector<T>& v) const
 	{
 		element.clear();
 		for (size_t i = 0; i != v.size(); i++)
 		{
-			document temp;
-			leech::put(temp, v[i]);
-			element.put_child(std::to_string(i), temp.root());
+			element_type& child = element.push_back(std::make_pair(std::to_string(i), element_type()))->second;
+			leech::put(*this, child, v[i]);
 		}
 	}
 	template<typename T>
 	void put(element_type& element, const std::map<std::string, T>& v) const
 	{
-		element.clear();
-		for (const auto& item : v)
-		{
-			document temp;
-			leech::put(temp, item.second);
-			element.put_child(item.first, temp.root());
-		}
+		put_map(element, v);
 	}
 	template<typename T>
 	void put(element_type& element, const std::unordered_map<std::string, T>& v) const
 	{
-		element.clear();
-		for (const auto& item : v)
-		{
-			document temp;
-			leech::put(temp, item.second);
-			element.put_child(item.first, temp.root());
-		}
+		put_map(element, v);
 	}
 
 	template<typename T>
@@ -116,33 +121,34 @@ public:
 	template<typename T>
 	void get(const element_type& element, std::vector<T>& v) const
 	{
-		v.clear();
+		v.resize(element.size());
+		size_t i = 0;
 		for (const auto& item : element)
 		{
-			T vi;
-			leech::get(*this, item.second, vi);
-			v.push_back(std::move(vi));
+			leech::get(*this, item.second, v[i++]);
 		}
 	}
-	template<typename T>
-	void get(const element_type& element, std::map<std::string, T>& v) const
+	// The elements of std::vector<bool> are bits, decoded through a bool.
+	void get(const element_type& element, std::vector<bool>& v) const
 	{
-		v.clear();
+		v.resize(element.size());
+		size_t i = 0;
 		for (const auto& item : element)
 		{
-			T vi;
-			leech::get(*this, item.second, vi);
-			v.emplace(item.first, std::move(vi));
+			bool value;
+			leech::get(*this, item.second, value);
+			v[i++] = value;
 		}
 	}
 	template<typename T>
+	void get(const element_type& element, std::map<std::string, T>& v) const
+	{
+		get_map(element, v);
+	}
+	template<typename T>
 	void get(const element_type& element, std::unordered_map<std::string, T>& v) const
 	{
-		v.clear();
-		for (const auto& item : element)
-		{
-			v.emplace(item.first, item.second.get_value<T>());
-		}
+		get_map(element, v);
 	}
 
 	static document load(std::istream& is)
@@ -156,16 +162,44 @@ public:
 		std::istringstream iss(text);
 		return load(iss);
 	}
-	static document load_file(const std::string& filename)
+	static document load_file(const std::string& filename, load_stats* stats = nullptr)
 	{
 		document doc;
-		read_info(filename, doc._root);
+		load_timer timer(stats);
+		mapped_file file;
+		if (!file.open(filename.c_str()))
+		{
+			read_info(filename, doc._root);
+			return doc;
+		}
+		timer.io_done();
+		memory_istream is(file);
+		read_info(is, doc._root);
+		timer.parse_done();
 		return doc;
 	}
 
 private:
 	ptree _root;
 
+	template<typename Map>
+	void put_map(element_type& element, const Map& v) const
+	{
+		element.clear();
+		for (const auto& item : v)
+		{
+			element_type& child = element.push_back(std::make_pair(item.first, element_type()))->second;
+			leech::put(*this, child, item.second);
+		}
+	}
+	template<typename Map>
+	void get_map(const element_type& element, Map& v) const
+	{
+		v.clear();
+		for (const auto& item : element)
+			leech::get(*this, item.second, v[item.first]);
+	}
+
 };
 
 
@@ -6,6 +6,25 @@
 #include <nlohmann/json.hpp>
 #include <fstream>
 #include <iomanip>
+#include <deque>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <iterator>
+#include "model.hpp"
+#include "sax.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
+#include "tracked.hpp"
+#ifdef LEECH_HAS_STRING_VIEW
+#include <charconv>
+#if defined(__has_include) && __has_include(<span>)
+#include <span>
+#endif
+#endif
 
 namespace leech
 {
@@ -59,6 +78,18 @@ namespace json
 		{
 			return element[name];
 		}
+		bool has_child(const element_type& element, const char* name) const
+		{
+			return element.is_object() && element.find(name) != element.end();
+		}
+		// Calls fn(name, child) for each member of an object, in the order the document stores them.
+		template<typename Fn>
+		void for_each_child(const element_type& element, Fn&& fn) const
+		{
+			if (!element.is_object()) return;
+			for (auto it = element.begin(); it != element.end(); ++it)
+				fn(it.key().c_str(), it.value());
+		}
 
 		template<typename T>
 		void put(element_type& element, const T& v) const
@@ -71,9 +102,61 @@ namespace json
 		{
 			element.get_to(v);
 		}
+		template<typename T, typename Allocator>
+		void get(const element_type& element, std::vector<T, Allocator>& v) const
+		{
+			const auto& items = element.get_ref<const nlohmann::json::array_t&>();
+			v.resize(items.size());
+			for (size_t i = 0; i != items.size(); i++)
+				leech::get(*this, items[i], v[i]);
+		}
+		// The elements of std::vector<bool> are bits, decoded through a bool.
+		template<typename Allocator>
+		void get(const element_type& element, std::vector<bool, Allocator>& v) const
+		{
+			const auto& items = element.get_ref<const nlohmann::json::array_t&>();
+			v.resize(items.size());
+			for (size_t i = 0; i != items.size(); i++)
+			{
+				bool item;
+				leech::get(*this, items[i], item);
+				v[i] = item;
+			}
+		}
+#ifdef LEECH_HAS_PMR
+		void get(const element_type& element, std::pmr::string& v) const
+		{
+			const auto& text = element.get_ref<const nlohmann::json::string_t&>();
+			v.assign(text.data(), text.size());
+		}
+		template<typename T>
+		void get(const element_type& element, std::pmr::map<std::pmr::string, T>& v) const
+		{
+			get_map(element, v);
+		}
+		template<typename T>
+		void get(const element_type& element, std::pmr::unordered_map<std::pmr::string, T>& v) const
+		{
+			get_map(element, v);
+		}
+#endif
 
 	private:
 		nlohmann::json::value_type _root;
+
+#ifdef LEECH_HAS_PMR
+		template<typename Map>
+		void get_map(const element_type& element, Map& v) const
+		{
+			const auto& items = element.get_ref<const nlohmann::json::object_t&>();
+			v.clear();
+			for (const auto& item : items)
+			{
+				typename Map::key_type key(item.first.data(), item.first.size(), v.get_allocator());
+				leech::get(*this, item.second, v[std::move(key)]);
+			}
+		}
+#endif
 	};
 
 	inline document load(const char* input)
@@ -90,11 +173,1211 @@ namespace json
 		input >> json;
 		return document(std::move(json));
 	}
-	inline document load_file(const char* filename)
+	inline document load_file(const char* filename, load_stats* stats = nullptr)
+	{
+		load_timer timer(stats);
+		mapped_file file;
+		if (!file.open(filename))
+		{
+			std::ifstream fs(filename);
+			return load(fs);
+		}
+		timer.io_done();
+		document doc(nlohmann::json::parse(file.begin(), file.end()));
+		timer.parse_done();
+		return doc;
+	}
+
+	// Adapts nlohmann::json::sax_parse to leech::sax::decoder.
+	class reader
+	{
+	public:
+		template<typename T>
+		explicit reader(T& v) : _decoder(v) { }
+
+		template<typename T>
+		void reset(T& v) { _decoder.reset(v); }
+
+		bool null() { _decoder.null_value(); return true; }
+		bool boolean(bool v) { _decoder.boolean(v); return true; }
+		bool number_integer(nlohmann::json::number_integer_t v) { _decoder.integer(v); return true; }
+		bool number_unsigned(nlohmann::json::number_unsigned_t v) { _decoder.unsigned_integer(v); return true; }
+		bool number_float(nlohmann::json::number_float_t v, const nlohmann::json::string_t&) { _decoder.floating(v); return true; }
+		bool string(nlohmann::json::string_t& v) { _decoder.string(v); return true; }
+		template<typename Binary>
+		bool binary(Binary&) { throw sax::error("binary values are not supported"); }
+		bool start_object(std::size_t) { _decoder.start_object(); return true; }
+		bool key(nlohmann::json::string_t& v) { _decoder.key(v); return true; }
+		bool end_object() { _decoder.end_object(); return true; }
+		bool start_array(std::size_t) { _decoder.start_array(); return true; }
+		bool end_array() { _decoder.end_array(); return true; }
+		template<typename Exception>
+		bool parse_error(std::size_t, const std::string&, const Exception& e) { throw e; }
+
+	private:
+		sax::decoder _decoder;
+	};
+
+	// Decodes JSON text directly into v, without building a nlohmann::json tree.
+	template<typename T>
+	inline void read(const char* first, const char* last, T& v)
+	{
+		reader handler(v);
+		nlohmann::json::sax_parse(first, last, &handler);
+	}
+	template<typename T>
+	inline void read(const char* input, T& v)
+	{
+		reader handler(v);
+		nlohmann::json::sax_parse(input, &handler);
+	}
+	template<typename T>
+	inline void read(const std::string& input, T& v)
 	{
-		std::ifstream fs(filename);
-		return load(fs);
+		reader handler(v);
+		nlohmann::json::sax_parse(input, &handler);
 	}
+	template<typename T>
+	inline void read(std::istream& input, T& v)
+	{
+		reader handler(v);
+		nlohmann::json::sax_parse(input, &handler);
+	}
+	template<typename T>
+	inline void read_file(const char* filename, T& v, load_stats* stats = nullptr)
+	{
+		load_timer timer(stats);
+		mapped_file file;
+		if (!file.open(filename))
+		{
+			std::ifstream fs(filename);
+			read(fs, v);
+			return;
+		}
+		timer.io_done();
+		read(file.begin(), file.end(), v);
+		timer.parse_done();
+	}
+
+	typedef std::vector<std::pair<const char*, const char*>> ranges;
+
+	// Finds the elements of the top-level array in [first, last) with a structural
+	// scan that only follows strings and brackets; elements are validated when decoded.
+	inline ranges split_array(const char* first, const char* last)
+	{
+		auto skip_space = [last](const char* p) {
+			while (p != last && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+			return p;
+		};
+		ranges result;
+		const char* p = skip_space(first);
+		if (p == last || *p != '[')
+			throw sax::error("expected a JSON array");
+		const char* start = skip_space(p + 1);
+		size_t depth = 0;
+		for (p = start; p != last; ++p)
+		{
+			switch (*p)
+			{
+			case '"':
+				for (++p; p != last && *p != '"'; ++p)
+				{
+					if (*p == '\\' && ++p == last) break;
+				}
+				if (p == last)
+					throw sax::error("unterminated string in JSON array");
+				break;
+			case '[':
+			case '{':
+				++depth;
+				break;
+			case ']':
+			case '}':
+				if (depth)
+				{
+					--depth;
+					break;
+				}
+				if (*p == '}')
+					throw sax::error("unbalanced brackets in JSON array");
+				if (p != start || !result.empty())
+					result.emplace_back(start, p);
+				if (skip_space(p + 1) != last)
+					throw sax::error("unexpected text after the JSON array");
+				return result;
+			case ',':
+				if (depth == 0)
+				{
+					result.emplace_back(start, p);
+					start = p + 1;
+				}
+				break;
+			}
+		}
+		throw sax::error("unterminated JSON array");
+	}
+
+	// Decodes a large top-level JSON array into v on several threads (0 for every
+	// hardware thread): split_array locates the elements, which are then decoded
+	// in chunks into preallocated elements of v.
+	template<typename T>
+	inline void parallel_get(const char* first, const char* last, std::vector<T>& v, size_t threads = 0)
+	{
+		static_assert(!std::is_same<T, bool>::value, "std::vector<bool> cannot be decoded in parallel");
+		ranges items = split_array(first, last);
+		v.resize(items.size());
+		parallel_for(items.size(), threads, [&items, &v](size_t begin, size_t end) {
+			reader handler(v[begin]);
+			for (size_t i = begin; i != end; i++)
+			{
+				handler.reset(v[i]);
+				nlohmann::json::sax_parse(items[i].first, items[i].second, &handler);
+			}
+		});
+	}
+	template<typename T>
+	inline void parallel_get(const std::string& input, std::vector<T>& v, size_t threads = 0)
+	{
+		parallel_get(input.data(), input.data() + input.size(), v, threads);
+	}
+	template<typename T>
+	inline void parallel_get(const mapped_file& input, std::vector<T>& v, size_t threads = 0)
+	{
+		parallel_get(input.begin(), input.end(), v, threads);
+	}
+
+	// Streams JSON text straight into a buffer without building a nlohmann::json tree.
+	// An element is closed lazily, when a sibling or an ancestor is written next.
+	class writer
+	{
+	public:
+		struct frame
+		{
+			enum state_type { empty, object, closed };
+
+			size_t depth;
+			state_type state;
+		};
+		typedef frame element_type;
+
+		writer() : _os(nullptr), _flush_size(0), _depth(0)
+		{
+			_frames.push_back(frame{ 0, frame::empty });
+		}
+		explicit writer(std::ostream& os, size_t flush_size = 64 * 1024)
+			: _os(&os), _flush_size(flush_size), _depth(0)
+		{
+			_frames.push_back(frame{ 0, frame::empty });
+		}
+		writer(const writer&) = delete;
+		writer& operator=(const writer&) = delete;
+
+		element_type& root() noexcept { return _frames.front(); }
+
+		// Completes the pending document and returns the buffered text.
+		const std::string& str()
+		{
+			finish();
+			return _buffer;
+		}
+		// Completes the pending document and writes the buffered text to the stream.
+		void flush()
+		{
+			finish();
+			drain();
+		}
+		// Completes the pending document, if one was started, and appends text after it.
+		// The next document is written to the same buffer, e.g. one JSON text per line.
+		void delimit(const char* text)
+		{
+			if (_frames.front().state != frame::empty)
+				finish();
+			_buffer += text;
+			_frames.front().state = frame::closed;
+			if (_os && _buffer.size() >= _flush_size)
+				drain();
+		}
+		// Drops the buffered text, keeps its capacity for the next document.
+		void clear() noexcept
+		{
+			_buffer.clear();
+			_depth = 0;
+			_frames.front().state = frame::empty;
+		}
+
+		element_type& child(element_type& element, const char* name)
+		{
+			unwind(element.depth);
+			if (element.state != frame::object)
+			{
+				_buffer += '{';
+				element.state = frame::object;
+			}
+			else
+			{
+				_buffer += ',';
+			}
+			write_string(name, strlen(name));
+			_buffer += ':';
+			return enter(element);
+		}
+
+		template<typename T>
+		void put(element_type& element, const T& v)
+		{
+			unwind(element.depth);
+			write_value(v);
+			element.state = frame::closed;
+		}
+		template<typename T>
+		void put(element_type& element, const std::vector<T>& v)
+		{
+			put_array(element, v);
+		}
+		template<typename T>
+		void put(element_type& element, const std::list<T>& v)
+		{
+			put_array(element, v);
+		}
+		template<typename T>
+		void put(element_type& element, const std::map<std::string, T>& v)
+		{
+			put_object(element, v);
+		}
+		template<typename T>
+		void put(element_type& element, const std::unordered_map<std::string, T>& v)
+		{
+			put_object(element, v);
+		}
+
+	private:
+		std::deque<frame> _frames;
+		std::string _buffer;
+		std::ostream* _os;
+		size_t _flush_size;
+		size_t _depth;
+
+		element_type& enter(const element_type& parent)
+		{
+			size_t depth = parent.depth + 1;
+			if (_frames.size() <= depth)
+				_frames.push_back(frame{ depth, frame::empty });
+			frame& result = _frames[depth];
+			result.state = frame::empty;
+			_depth = depth;
+			if (_os && _buffer.size() >= _flush_size)
+				drain();
+			return result;
+		}
+		void unwind(size_t depth)
+		{
+			for (; _depth > depth; --_depth)
+				close(_frames[_depth]);
+		}
+		void close(frame& f)
+		{
+			// Nothing was written into an empty frame: a reflected object without fields to write.
+			if (f.state == frame::object)
+				_buffer += '}';
+			else if (f.state == frame::empty)
+				_buffer += "{}";
+			f.state = frame::closed;
+		}
+		void finish()
+		{
+			unwind(0);
+			if (_frames.front().state != frame::closed)
+				close(_frames.front());
+		}
+		void drain()
+		{
+			if (_os && !_buffer.empty())
+			{
+				_os->write(_buffer.data(), _buffer.size());
+				_buffer.clear();
+			}
+		}
+
+		template<typename Range>
+		void put_array(element_type& element, const Range& v)
+		{
+			unwind(element.depth);
+			_buffer += '[';
+			bool first = true;
+			for (const auto& item : v)
+			{
+				if (!first) _buffer += ',';
+				first = false;
+				leech::put(*this, enter(element), item);
+				unwind(element.depth);
+			}
+			_buffer += ']';
+			element.state = frame::closed;
+		}
+		template<typename Map>
+		void put_object(element_type& element, const Map& v)
+		{
+			unwind(element.depth);
+			element.state = frame::empty;
+			for (const auto& item : v)
+			{
+				leech::put(*this, child(element, item.first.c_str()), item.second);
+			}
+			unwind(element.depth);
+			if (element.state == frame::empty)
+				_buffer += "{}";
+			else
+				close(element);
+			element.state = frame::closed;
+		}
+
+		void write_value(bool v)
+		{
+			_buffer += v ? "true" : "false";
+		}
+		void write_value(const char* v)
+		{
+			write_string(v, strlen(v));
+		}
+		void write_value(const std::string& v)
+		{
+			write_string(v.data(), v.size());
+		}
+		template<typename T>
+		typename std::enable_if<std::is_integral<T>::value>::type write_value(T v)
+		{
+			char text[24];
+			char* last = text + sizeof(text);
+			char* first = last;
+			typename std::make_unsigned<T>::type n = static_cast<typename std::make_unsigned<T>::type>(v);
+			bool negative = is_negative(v, std::is_signed<T>());
+			if (negative) n = 0 - n;
+			do
+			{
+				*--first = static_cast<char>('0' + n % 10);
+				n /= 10;
+			} while (n);
+			if (negative) *--first = '-';
+			_buffer.append(first, last);
+		}
+		template<typename T>
+		static bool is_negative(T v, std::true_type) noexcept { return v < 0; }
+		template<typename T>
+		static bool is_negative(T, std::false_type) noexcept { return false; }
+		template<typename T>
+		typename std::enable_if<std::is_floating_point<T>::value>::type write_value(T v)
+		{
+			if (!std::isfinite(v))
+			{
+				_buffer += "null";
+				return;
+			}
+			// The shortest digits that read back to the same float or double. A double is laid
+			// out as nlohmann::json::dump does it: fixed notation from 1e-4 to below 1e15, an
+			// exponent outside that range, and ".0" after integral values. dump widens a float
+			// to double first, so a float keeps its own shorter digits here instead.
+			typedef typename std::conditional<std::is_same<T, float>::value, float, double>::type real;
+			real r = static_cast<real>(v);
+			char text[32];
+			int length = 0;
+			// Fewer digits than digits10 are always found at digits10, except for subnormals.
+			int shortest = std::fabs(r) < std::numeric_limits<real>::min() ? 1 : std::numeric_limits<real>::digits10;
+			for (int precision = shortest; precision <= std::numeric_limits<real>::max_digits10; precision++)
+			{
+				// %g turns to fixed notation below 1e16 or 1e17 with 16 or 17 digits, dump from 1e15.
+				if (precision > 15 && std::fabs(r) >= 1e15)
+					length = snprintf(text, sizeof(text), "%.*e", precision - 1, static_cast<double>(r));
+				else
+					length = snprintf(text, sizeof(text), "%.*g", precision, static_cast<double>(r));
+				if (read_back(text, r) == r)
+					break;
+			}
+			_buffer.append(text, length);
+			if (!strpbrk(text, ".e"))
+				_buffer += ".0";
+		}
+		static float read_back(const char* text, float) { return strtof(text, nullptr); }
+		static double read_back(const char* text, double) { return strtod(text, nullptr); }
+		template<typename T>
+		typename std::enable_if<!std::is_arithmetic<T>::value>::type write_value(const T& v)
+		{
+			_buffer += nlohmann::json(v).dump();
+		}
+
+		void write_string(const char* text, size_t length)
+		{
+			static const char hex[] = "0123456789abcdef";
+			_buffer += '"';
+			const char* first = text;
+			const char* last = text + length;
+			for (const char* p = first; p != last; ++p)
+			{
+				unsigned char c = static_cast<unsigned char>(*p);
+				if (c >= 0x20 && c != '"' && c != '\\')
+					continue;
+				_buffer.append(first, p);
+				first = p + 1;
+				_buffer += '\\';
+				switch (c)
+				{
+				case '"': _buffer += '"'; break;
+				case '\\': _buffer += '\\'; break;
+				case '\b': _buffer += 'b'; break;
+				case '\f': _buffer += 'f'; break;
+				case '\n': _buffer += 'n'; break;
+				case '\r': _buffer += 'r'; break;
+				case '\t': _buffer += 't'; break;
+				default:
+					_buffer += "u00";
+					_buffer += hex[c >> 4];
+					_buffer += hex[c & 0x0f];
+				}
+			}
+			_buffer.append(first, last);
+			_buffer += '"';
+		}
+	};
+
+	// Newline-delimited JSON, or an RFC 7464 JSON text sequence where each record starts with RS (0x1E).
+	enum class record_format { lines, sequence };
+
+	// Decodes one T per record of newline-delimited JSON or of a JSON text sequence;
+	// the format is detected from the first record. Files are mapped and read front
+	// to back, releasing the pages already read, so memory stays bounded on any file size.
+	template<typename T>
+	class record_reader
+	{
+	public:
+		class iterator
+		{
+		public:
+			typedef std::input_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const T* pointer;
+			typedef const T& reference;
+
+			iterator() noexcept : _owner(nullptr) { }
+			explicit iterator(record_reader* owner) : _owner(owner) { ++*this; }
+
+			reference operator*() const noexcept { return _owner->_value; }
+			pointer operator->() const noexcept { return &_owner->_value; }
+			// Every record is decoded into the same T, as by next(), so its storage is reused.
+			iterator& operator++()
+			{
+				if (!_owner->next(_owner->_value))
+					_owner = nullptr;
+				return *this;
+			}
+			void operator++(int) { ++*this; }
+			bool operator==(const iterator& rhs) const noexcept { return _owner == rhs._owner; }
+			bool operator!=(const iterator& rhs) const noexcept { return _owner != rhs._owner; }
+
+		private:
+			record_reader* _owner;
+		};
+
+		explicit record_reader(const char* filename)
+			: _input(nullptr), _pos(nullptr), _end(nullptr), _released(0), _delimiter(0), _count(0), _handler(_value)
+		{
+			if (_file.map(filename, true))
+			{
+				_pos = _file.begin();
+				_end = _file.end();
+			}
+			else
+			{
+				_stream.reset(new std::ifstream(filename, std::ios::binary));
+				if (!*_stream)
+					throw std::ios_base::failure(std::string("cannot open ") + filename);
+				_input = _stream.get();
+			}
+		}
+		explicit record_reader(std::istream& input)
+			: _input(&input), _pos(nullptr), _end(nullptr), _released(0), _delimiter(0), _count(0), _handler(_value) { }
+		record_reader(const record_reader&) = delete;
+		record_reader& operator=(const record_reader&) = delete;
+
+		iterator begin() { return iterator(this); }
+		iterator end() noexcept { return iterator(); }
+
+		// Decodes the next record into v and reuses its storage; fields absent from
+		// the record keep their values. Returns false at the end of the input.
+		bool next(T& v)
+		{
+			const char* first = nullptr;
+			const char* last = nullptr;
+			if (!(_input ? read_record(first, last) : map_record(first, last)))
+				return false;
+			_handler.reset(v);
+			nlohmann::json::sax_parse(first, last, &_handler);
+			++_count;
+			return true;
+		}
+		// The number of records decoded so far.
+		size_t count() const noexcept { return _count; }
+
+	private:
+		mapped_file _file;
+		std::unique_ptr<std::istream> _stream;
+		std::istream* _input;
+		const char* _pos;
+		const char* _end;
+		size_t _released;
+		char _delimiter;
+		size_t _count;
+		std::string _line;
+		T _value;
+		reader _handler;
+
+		static const char record_separator = '\x1e';
+		static const size_t release_size = 64 * 1024 * 1024;
+
+		static bool is_blank(char c) noexcept
+		{
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == record_separator;
+		}
+
+		bool map_record(const char*& first, const char*& last)
+		{
+			while (_pos != _end && is_blank(*_pos))
+			{
+				if (!_delimiter && *_pos == record_separator)
+					_delimiter = record_separator;
+				++_pos;
+			}
+			if (_pos == _end)
+				return false;
+			if (!_delimiter) _delimiter = '\n';
+			size_t offset = static_cast<size_t>(_pos - _file.begin());
+			if (offset - _released >= release_size)
+			{
+				_file.discard(offset);
+				_released = offset;
+			}
+			first = _pos;
+			last = static_cast<const char*>(memchr(_pos, _delimiter, static_cast<size_t>(_end - _pos)));
+			if (!last) last = _end;
+			_pos = last;
+			return true;
+		}
+		bool read_record(const char*& first, const char*& last)
+		{
+			if (!_delimiter)
+			{
+				*_input >> std::ws;
+				_delimiter = _input->peek() == record_separator ? record_separator : '\n';
+			}
+			while (std::getline(*_input, _line, _delimiter))
+			{
+				const char* p = _line.data();
+				const char* end = p + _line.size();
+				while (p != end && is_blank(*p)) ++p;
+				if (p == end)
+					continue;
+				first = p;
+				last = end;
+				return true;
+			}
+			return false;
+		}
+	};
+
+	// Encodes one T per record, as newline-delimited JSON or as a JSON text sequence.
+	// Records share one buffer that is written to the stream every flush_size bytes.
+	template<typename T>
+	class record_writer
+	{
+	public:
+		explicit record_writer(std::ostream& os, record_format format = record_format::lines, size_t flush_size = 64 * 1024)
+			: _writer(os, flush_size), _format(format) { }
+		record_writer(const record_writer&) = delete;
+		record_writer& operator=(const record_writer&) = delete;
+		~record_writer()
+		{
+			try
+			{
+				flush();
+			}
+			catch (...)
+			{
+			}
+		}
+
+		void write(const T& v)
+		{
+			if (_format == record_format::sequence)
+				_writer.delimit("\x1e");
+			leech::put(_writer, _writer.root(), v);
+			_writer.delimit("\n");
+		}
+		void flush()
+		{
+			_writer.flush();
+		}
+
+	private:
+		writer _writer;
+		record_format _format;
+	};
+
+	// The JSON text of a tracked<T>, kept per field, so str only encodes again the
+	// fields that changed since the previous call and joins the cached rest.
+	template<typename T>
+	class fragment_cache
+	{
+	public:
+		const std::string& str(tracked<T>& v)
+		{
+			typename tracked<T>::field_set fields = v.pending(_target);
+			const auto& table = field_table<T>;
+			for (size_t i = 0; i != table.size(); i++)
+			{
+				if (!fields[i] || (table[i].flags & field_skip_write)) continue;
+				detail::struct_info<T>::instance().find_field(i, [&](const auto& field) {
+					// Written as a one-member object, so the name is escaped like any other
+					// key; the fragment is the member between the braces.
+					_writer.clear();
+					leech::put(_writer, _writer.child(_writer.root(), field.name()), field.get_value(v.value()));
+					const std::string& text = _writer.str();
+					_fragments[i].assign(text, 1, text.size() - 2);
+				});
+			}
+			v.clean(_target);
+			_text.assign(1, '{');
+			for (const std::string& fragment : _fragments)
+			{
+				if (fragment.empty()) continue;
+				if (_text.size() > 1) _text += ',';
+				_text += fragment;
+			}
+			_text += '}';
+			return _text;
+		}
+		void save(std::ostream& os, tracked<T>& v)
+		{
+			os << str(v);
+		}
+
+	private:
+		write_target _target;
+		writer _writer;
+		std::array<std::string, field_table<T>.size()> _fragments;
+		std::string _text;
+	};
+
+#ifdef LEECH_HAS_STRING_VIEW
+	// A read-only JSON document that decodes strings as std::string_view into the input
+	// instead of copying them. The text is tokenized once into a flat tape; strings without
+	// escapes point into the input and escaped strings are decoded into an arena of the
+	// document. Views stay valid as long as the document, which owns the input when it is
+	// loaded from a file or a moved string.
+	class view_document
+	{
+	public:
+		enum class value_kind : std::uint8_t { null, boolean, number, string, array, object };
+
+		// One value of the tape. Each member of an object is a string key followed by its value.
+		struct element_type
+		{
+			value_kind kind;
+			// Members of an object, elements of an array.
+			size_t count;
+			// Index of the tape just past this value and everything it contains.
+			size_t end;
+			// A string, or the text of a number or literal.
+			std::string_view text;
+		};
+
+		view_document() noexcept : _data(nullptr), _size(0) { }
+		// Views into memory owned by the caller, which must outlive the document.
+		view_document(const char* data, size_t size) : _data(data), _size(size)
+		{
+			parse();
+		}
+		explicit view_document(std::string&& text) : _text(new std::string(std::move(text)))
+		{
+			_data = _text->data();
+			_size = _text->size();
+			parse();
+		}
+		explicit view_document(mapped_file&& file) : _file(new mapped_file(std::move(file)))
+		{
+			_data = _file->data();
+			_size = _file->size();
+			parse();
+		}
+		view_document(view_document&&) = default;
+		view_document& operator=(view_document&&) = default;
+
+		const element_type& root() const
+		{
+			if (_tape.empty())
+				throw std::out_of_range("empty JSON document");
+			return _tape.front();
+		}
+		const element_type& child(const element_type& element, const char* name) const
+		{
+			const element_type* value = find(element, name);
+			if (!value)
+				throw std::out_of_range(std::string("key '") + name + "' not found");
+			return *value;
+		}
+		bool has_child(const element_type& element, const char* name) const
+		{
+			return find(element, name) != nullptr;
+		}
+		template<typename Fn>
+		void for_each_child(const element_type& element, Fn&& fn) const
+		{
+			if (element.kind != value_kind::object) return;
+			std::string name;
+			for (size_t i = index(element) + 1; i != element.end; i = _tape[i + 1].end)
+			{
+				name.assign(_tape[i].text.data(), _tape[i].text.size());
+				fn(name.c_str(), _tape[i + 1]);
+			}
+		}
+
+		void get(const element_type& element, bool& v) const
+		{
+			expect(element, value_kind::boolean, "boolean");
+			v = element.text[0] == 't';
+		}
+		template<typename T>
+		typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type get(const element_type& element, T& v) const
+		{
+			expect(element, value_kind::number, "number");
+			v = number<T>(element.text, std::is_integral<T>());
+		}
+		template<typename T>
+		typename std::enable_if<std::is_enum<T>::value>::type get(const element_type& element, T& v) const
+		{
+			typename std::underlying_type<T>::type n;
+			get(element, n);
+			v = static_cast<T>(n);
+		}
+		void get(const element_type& element, std::string_view& v) const
+		{
+			expect(element, value_kind::string, "string");
+			v = element.text;
+		}
+		template<typename Traits, typename Allocator>
+		void get(const element_type& element, std::basic_string<char, Traits, Allocator>& v) const
+		{
+			expect(element, value_kind::string, "string");
+			v.assign(element.text.data(), element.text.size());
+		}
+#ifdef __cpp_lib_span
+		// The bytes of a string, for blobs.
+		void get(const element_type& element, std::span<const char>& v) const
+		{
+			expect(element, value_kind::string, "string");
+			v = std::span<const char>(element.text.data(), element.text.size());
+		}
+#endif
+		template<typename T, typename Allocator>
+		void get(const element_type& element, std::vector<T, Allocator>& v) const
+		{
+			get_sequence(element, v);
+		}
+		template<typename Allocator>
+		void get(const element_type& element, std::vector<bool, Allocator>& v) const
+		{
+			expect(element, value_kind::array, "array");
+			v.resize(element.count);
+			size_t i = index(element) + 1;
+			for (size_t n = 0; n != element.count; n++)
+			{
+				bool item;
+				leech::get(*this, _tape[i], item);
+				v[n] = item;
+				i = _tape[i].end;
+			}
+		}
+		template<typename T, typename Allocator>
+		void get(const element_type& element, std::list<T, Allocator>& v) const
+		{
+			get_sequence(element, v);
+		}
+		template<typename K, typename T, typename Compare, typename Allocator>
+		void get(const element_type& element, std::map<K, T, Compare, Allocator>& v) const
+		{
+			get_map(element, v);
+		}
+		template<typename K, typename T, typename Hash, typename Equal, typename Allocator>
+		void get(const element_type& element, std::unordered_map<K, T, Hash, Equal, Allocator>& v) const
+		{
+			get_map(element, v);
+		}
+
+	private:
+		std::unique_ptr<std::string> _text;
+		std::unique_ptr<mapped_file> _file;
+		const char* _data;
+		size_t _size;
+		std::vector<element_type> _tape;
+		// Escaped strings; a deque never moves the strings it holds.
+		std::deque<std::string> _arena;
+
+		size_t index(const element_type& element) const noexcept
+		{
+			return static_cast<size_t>(&element - _tape.data());
+		}
+		const element_type* find(const element_type& element, const char* name) const
+		{
+			if (element.kind != value_kind::object) return nullptr;
+			std::string_view key(name);
+			for (size_t i = index(element) + 1; i != element.end; i = _tape[i + 1].end)
+			{
+				if (_tape[i].text == key)
+					return &_tape[i + 1];
+			}
+			return nullptr;
+		}
+		static void expect(const element_type& element, value_kind kind, const char* expected)
+		{
+			static const char* names[] = { "null", "boolean", "number", "string", "array", "object" };
+			if (element.kind != kind)
+				throw sax::error(std::string("type mismatch, expected ") + expected + " but found " + names[static_cast<int>(element.kind)]);
+		}
+		template<typename T>
+		static T number(std::string_view text, std::true_type)
+		{
+			T v;
+			auto result = std::from_chars(text.data(), text.data() + text.size(), v);
+			if (result.ec == std::errc() && result.ptr == text.data() + text.size())
+				return v;
+			return static_cast<T>(number<double>(text, std::false_type()));
+		}
+		template<typename T>
+		static T number(std::string_view text, std::false_type)
+		{
+			// The input is not null-terminated, and strtod needs it.
+			char buffer[64];
+			std::string copy;
+			const char* first = buffer;
+			if (text.size() < sizeof(buffer))
+			{
+				memcpy(buffer, text.data(), text.size());
+				buffer[text.size()] = 0;
+			}
+			else
+			{
+				copy.assign(text.data(), text.size());
+				first = copy.c_str();
+			}
+			char* last;
+			double v = strtod(first, &last);
+			if (last != first + text.size())
+				throw sax::error("invalid number in JSON text");
+			return static_cast<T>(v);
+		}
+		template<typename Sequence>
+		void get_sequence(const element_type& element, Sequence& v) const
+		{
+			expect(element, value_kind::array, "array");
+			v.resize(element.count);
+			size_t i = index(element) + 1;
+			for (auto& item : v)
+			{
+				leech::get(*this, _tape[i], item);
+				i = _tape[i].end;
+			}
+		}
+		template<typename Map>
+		void get_map(const element_type& element, Map& v) const
+		{
+			expect(element, value_kind::object, "object");
+			v.clear();
+			for (size_t i = index(element) + 1; i != element.end; i = _tape[i + 1].end)
+				leech::get(*this, _tape[i + 1], v[typename Map::key_type(_tape[i].text)]);
+		}
+
+		static const char* skip_space(const char* p, const char* last) noexcept
+		{
+			while (p != last && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) ++p;
+			return p;
+		}
+		void push(value_kind kind, std::string_view text)
+		{
+			_tape.push_back(element_type{ kind, 0, _tape.size() + 1, text });
+		}
+		void parse()
+		{
+			const char* p = _data;
+			const char* last = _data + _size;
+			std::vector<size_t> open;
+			for (;;)
+			{
+				p = skip_space(p, last);
+				if (p == last)
+					throw sax::error("unexpected end of JSON text");
+				if (*p == '{' || *p == '[')
+				{
+					value_kind kind = *p == '{' ? value_kind::object : value_kind::array;
+					open.push_back(_tape.size());
+					_tape.push_back(element_type{ kind, 0, 0, std::string_view() });
+					p = skip_space(p + 1, last);
+					if (p == last || *p != (kind == value_kind::object ? '}' : ']'))
+					{
+						if (kind == value_kind::object)
+							p = key(p, last);
+						continue;
+					}
+					++p;
+					_tape[open.back()].end = _tape.size();
+					open.pop_back();
+				}
+				else
+				{
+					p = scalar(p, last);
+				}
+				// A value is complete: close the containers that end with it, up to the next value.
+				for (;;)
+				{
+					if (open.empty())
+					{
+						if (skip_space(p, last) != last)
+							throw sax::error("unexpected text after the JSON value");
+						return;
+					}
+					element_type& top = _tape[open.back()];
+					++top.count;
+					p = skip_space(p, last);
+					if (p == last)
+						throw sax::error("unexpected end of JSON text");
+					if (*p == ',')
+					{
+						if (top.kind == value_kind::object)
+							p = key(skip_space(p + 1, last), last);
+						else
+							++p;
+						break;
+					}
+					if (*p != (top.kind == value_kind::object ? '}' : ']'))
+						throw sax::error("expected ',' or a closing bracket in JSON text");
+					++p;
+					top.end = _tape.size();
+					open.pop_back();
+				}
+			}
+		}
+		const char* key(const char* p, const char* last)
+		{
+			if (p == last || *p != '"')
+				throw sax::error("expected a key in JSON object");
+			p = skip_space(string(p, last), last);
+			if (p == last || *p != ':')
+				throw sax::error("expected ':' in JSON object");
+			return p + 1;
+		}
+		const char* scalar(const char* p, const char* last)
+		{
+			auto literal = [&](const char* text, size_t length, value_kind kind) {
+				if (static_cast<size_t>(last - p) < length || memcmp(p, text, length) != 0)
+					throw sax::error("invalid literal in JSON text");
+				push(kind, std::string_view(p, length));
+				return p + length;
+			};
+			switch (*p)
+			{
+			case '"':
+				return string(p, last);
+			case 't':
+				return literal("true", 4, value_kind::boolean);
+			case 'f':
+				return literal("false", 5, value_kind::boolean);
+			case 'n':
+				return literal("null", 4, value_kind::null);
+			default:
+				if (*p != '-' && (*p < '0' || *p > '9'))
+					throw sax::error("unexpected character in JSON text");
+				const char* first = p;
+				while (p != last && ((*p >= '0' && *p <= '9') || *p == '-' || *p == '+' || *p == '.' || *p == 'e' || *p == 'E')) ++p;
+				push(value_kind::number, std::string_view(first, static_cast<size_t>(p - first)));
+				return p;
+			}
+		}
+		const char* string(const char* p, const char* last)
+		{
+			const char* first = ++p;
+			bool escaped = false;
+			for (; p != last && *p != '"'; ++p)
+			{
+				if (*p == '\\')
+				{
+					escaped = true;
+					if (++p == last) break;
+				}
+				else if (static_cast<unsigned char>(*p) < 0x20)
+					throw sax::error("control character in JSON string");
+			}
+			if (p == last)
+				throw sax::error("unterminated JSON string");
+			std::string_view text(first, static_cast<size_t>(p - first));
+			push(value_kind::string, escaped ? unescape(text) : text);
+			return p + 1;
+		}
+		std::string_view unescape(std::string_view text)
+		{
+			_arena.emplace_back();
+			std::string& out = _arena.back();
+			out.reserve(text.size());
+			for (size_t i = 0; i != text.size(); i++)
+			{
+				if (text[i] != '\\')
+				{
+					out += text[i];
+					continue;
+				}
+				switch (text[++i])
+				{
+				case '"': out += '"'; break;
+				case '\\': out += '\\'; break;
+				case '/': out += '/'; break;
+				case 'b': out += '\b'; break;
+				case 'f': out += '\f'; break;
+				case 'n': out += '\n'; break;
+				case 'r': out += '\r'; break;
+				case 't': out += '\t'; break;
+				case 'u':
+				{
+					unsigned long code = hex(text, i + 1);
+					i += 4;
+					if (code >= 0xd800 && code < 0xdc00 && i + 6 < text.size() && text[i + 1] == '\\' && text[i + 2] == 'u')
+					{
+						unsigned long low = hex(text, i + 3);
+						if (low >= 0xdc00 && low < 0xe000)
+						{
+							code = 0x10000 + ((code - 0xd800) << 10) + (low - 0xdc00);
+							i += 6;
+						}
+					}
+					append_utf8(out, code);
+					break;
+				}
+				default:
+					throw sax::error("invalid escape in JSON string");
+				}
+			}
+			return out;
+		}
+		static unsigned long hex(std::string_view text, size_t i)
+		{
+			if (i + 4 > text.size())
+				throw sax::error("invalid unicode escape in JSON string");
+			unsigned long code = 0;
+			for (size_t end = i + 4; i != end; i++)
+			{
+				char c = text[i];
+				code <<= 4;
+				if (c >= '0' && c <= '9') code |= static_cast<unsigned long>(c - '0');
+				else if (c >= 'a' && c <= 'f') code |= static_cast<unsigned long>(c - 'a' + 10);
+				else if (c >= 'A' && c <= 'F') code |= static_cast<unsigned long>(c - 'A' + 10);
+				else throw sax::error("invalid unicode escape in JSON string");
+			}
+			return code;
+		}
+		static void append_utf8(std::string& out, unsigned long code)
+		{
+			if (code < 0x80)
+				out += static_cast<char>(code);
+			else if (code < 0x800)
+			{
+				out += static_cast<char>(0xc0 | (code >> 6));
+				out += static_cast<char>(0x80 | (code & 0x3f));
+			}
+			else if (code < 0x10000)
+			{
+				out += static_cast<char>(0xe0 | (code >> 12));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+				out += static_cast<char>(0x80 | (code & 0x3f));
+			}
+			else
+			{
+				out += static_cast<char>(0xf0 | (code >> 18));
+				out += static_cast<char>(0x80 | ((code >> 12) & 0x3f));
+				out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+				out += static_cast<char>(0x80 | (code & 0x3f));
+			}
+		}
+	};
+
+	inline view_document load_view(std::string&& input)
+	{
+		return view_document(std::move(input));
+	}
+	// Maps the file, which the document keeps until it is destroyed.
+	inline view_document load_view_file(const char* filename, load_stats* stats = nullptr)
+	{
+		load_timer timer(stats);
+		mapped_file file;
+		if (!file.open(filename))
+			throw std::ios_base::failure(std::string("cannot open ") + filename);
+		timer.io_done();
+		view_document doc(std::move(file));
+		timer.parse_done();
+		return doc;
+	}
+#endif
+
+}
+
+}
+
+namespace leech
+{
+
+namespace sax
+{
+
+	// Captures a subtree as nlohmann::json, for members that keep free-form JSON.
+	template<>
+	struct value_ops<nlohmann::json>
+	{
+		static void null_value(void* target) { *static_cast<nlohmann::json*>(target) = nullptr; }
+		static void boolean(void* target, bool v) { *static_cast<nlohmann::json*>(target) = v; }
+		static void integer(void* target, long long v) { *static_cast<nlohmann::json*>(target) = v; }
+		static void unsigned_integer(void* target, unsigned long long v) { *static_cast<nlohmann::json*>(target) = v; }
+		static void floating(void* target, double v) { *static_cast<nlohmann::json*>(target) = v; }
+		static void string(void* target, const std::string& v) { *static_cast<nlohmann::json*>(target) = v; }
+		static void start_object(frame& f)
+		{
+			*static_cast<nlohmann::json*>(f.target.target) = nlohmann::json::object();
+		}
+		static bool key(frame& f, const std::string& name, slot& next)
+		{
+			next = make_slot((*static_cast<nlohmann::json*>(f.target.target))[name]);
+			return true;
+		}
+		static void start_array(frame& f)
+		{
+			*static_cast<nlohmann::json*>(f.target.target) = nlohmann::json::array();
+		}
+		static void element(frame& f, slot& next)
+		{
+			nlohmann::json& v = *static_cast<nlohmann::json*>(f.target.target);
+			v.push_back(nullptr);
+			next = make_slot(v.back());
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "json";
+			result.null_value = &null_value;
+			result.boolean = &boolean;
+			result.integer = &integer;
+			result.unsigned_integer = &unsigned_integer;
+			result.floating = &floating;
+			result.string = &string;
+			result.start_object = &start_object;
+			result.key = &key;
+			result.start_array = &start_array;
+			result.element = &element;
+			return result;
+		}
+	};
 
 }
 
@@ -0,0 +1,267 @@
+#ifndef _LEECH_MAPPED_FILE_HPP_
+#define _LEECH_MAPPED_FILE_HPP_
+
+#pragma once
+
+#include <string>
+#include <istream>
+#include <streambuf>
+#include <chrono>
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace leech
+{
+
+	// Time spent by load_file reading the input and parsing it.
+	struct load_stats
+	{
+		std::chrono::nanoseconds io;
+		std::chrono::nanoseconds parse;
+	};
+
+	// Measures the stages of a load_file call into an optional load_stats.
+	class load_timer
+	{
+	public:
+		explicit load_timer(load_stats* stats) noexcept : _stats(stats)
+		{
+			if (_stats) _start = std::chrono::steady_clock::now();
+		}
+		void io_done() noexcept
+		{
+			if (_stats) _stats->io = lap();
+		}
+		void parse_done() noexcept
+		{
+			if (_stats) _stats->parse = lap();
+		}
+
+	private:
+		load_stats* _stats;
+		std::chrono::steady_clock::time_point _start;
+
+		std::chrono::nanoseconds lap() noexcept
+		{
+			auto now = std::chrono::steady_clock::now();
+			auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(now - _start);
+			_start = now;
+			return elapsed;
+		}
+	};
+
+	// While an unmapped_scope is alive, mapped_file reads files on that thread with read()
+	// instead of mapping them. A mapped file that another process truncates raises SIGBUS
+	// when the lost pages are read; read() only sees a short file, which fails to parse.
+	class unmapped_scope
+	{
+	public:
+		unmapped_scope() noexcept : _previous(active()) { state() = true; }
+		unmapped_scope(const unmapped_scope&) = delete;
+		unmapped_scope& operator=(const unmapped_scope&) = delete;
+		~unmapped_scope() { state() = _previous; }
+
+		static bool active() noexcept { return state(); }
+
+	private:
+		bool _previous;
+
+		static bool& state() noexcept
+		{
+			static thread_local bool value = false;
+			return value;
+		}
+	};
+
+	// The contents of a file as one contiguous read-only block. Regular files are
+	// memory-mapped; pipes, devices and files that cannot be mapped are read() into a buffer.
+	class mapped_file
+	{
+	public:
+		mapped_file() noexcept : _map(nullptr), _data(nullptr), _size(0) { }
+		mapped_file(const mapped_file&) = delete;
+		mapped_file(mapped_file&& src) noexcept
+			: _map(src._map), _buffer(std::move(src._buffer)), _data(src._data), _size(src._size)
+		{
+			if (!_map) _data = _buffer.data();
+			src._map = nullptr;
+			src._data = nullptr;
+			src._size = 0;
+		}
+		~mapped_file() { close(); }
+		mapped_file& operator=(const mapped_file&) = delete;
+		mapped_file& operator=(mapped_file&& src) noexcept
+		{
+			if (this != &src)
+			{
+				close();
+				_map = src._map;
+				_buffer = std::move(src._buffer);
+				_data = _map ? src._data : _buffer.data();
+				_size = src._size;
+				src._map = nullptr;
+				src._data = nullptr;
+				src._size = 0;
+			}
+			return *this;
+		}
+
+		// Returns false if the file cannot be opened or read.
+		bool open(const char* filename)
+		{
+			close();
+#ifdef _WIN32
+			std::ifstream fs(filename, std::ios::binary);
+			if (!fs) return false;
+			std::ostringstream oss;
+			oss << fs.rdbuf();
+			_buffer = oss.str();
+#else
+			int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return false;
+			bool ok = (!unmapped_scope::active() && map_file(fd, false)) || read_all(fd);
+			::close(fd);
+			if (!ok) return false;
+			if (_map) return true;
+#endif
+			_data = _buffer.data();
+			_size = _buffer.size();
+			return true;
+		}
+		// Only maps the file, returns false if it is not a non-empty regular file or cannot be mapped.
+		// A sequential mapping is paged in as it is read rather than up front, and discard
+		// releases the pages that were consumed, so reading a large file keeps memory bounded.
+		bool map(const char* filename, bool sequential = false)
+		{
+			close();
+#ifdef _WIN32
+			(void)filename;
+			(void)sequential;
+			return false;
+#else
+			if (unmapped_scope::active()) return false;
+			int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+			if (fd < 0) return false;
+			bool ok = map_file(fd, sequential);
+			::close(fd);
+			return ok;
+#endif
+		}
+		// Releases the mapped pages before offset; they are read again if accessed.
+		void discard(size_t offset) noexcept
+		{
+#ifndef _WIN32
+			if (!_map) return;
+			size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			offset -= offset % page;
+			if (offset) madvise(_map, offset, MADV_DONTNEED);
+#else
+			(void)offset;
+#endif
+		}
+		void close() noexcept
+		{
+#ifndef _WIN32
+			if (_map) munmap(_map, _size);
+#endif
+			_map = nullptr;
+			_buffer.clear();
+			_data = nullptr;
+			_size = 0;
+		}
+
+		const char* data() const noexcept { return _data; }
+		size_t size() const noexcept { return _size; }
+		const char* begin() const noexcept { return _data; }
+		const char* end() const noexcept { return _data + _size; }
+
+	private:
+		void* _map;
+		std::string _buffer;
+		const char* _data;
+		size_t _size;
+
+#ifndef _WIN32
+		bool map_file(int fd, bool sequential)
+		{
+			struct stat st;
+			if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+				return false;
+			int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+			if (!sequential) flags |= MAP_POPULATE;
+#endif
+			void* map = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, flags, fd, 0);
+			if (map == MAP_FAILED)
+				return false;
+			if (sequential) madvise(map, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+			_map = map;
+			_data = static_cast<const char*>(map);
+			_size = static_cast<size_t>(st.st_size);
+			return true;
+		}
+		bool read_all(int fd)
+		{
+			char chunk[64 * 1024];
+			for (;;)
+			{
+				ssize_t n = ::read(fd, chunk, sizeof(chunk));
+				if (n > 0)
+					_buffer.append(chunk, static_cast<size_t>(n));
+				else if (n == 0)
+					return true;
+				else if (errno != EINTR)
+					return false;
+			}
+		}
+#endif
+	};
+
+	// A std::streambuf reading from memory without copying it, for parsers that only take streams.
+	class memory_buffer : public std::streambuf
+	{
+	public:
+		memory_buffer(const char* data, size_t size)
+		{
+			char* first = const_cast<char*>(data);
+			setg(first, first, first + size);
+		}
+
+	protected:
+		pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+		{
+			if ((which & std::ios_base::in) == 0)
+				return pos_type(off_type(-1));
+			char* base = dir == std::ios_base::beg ? eback() : dir == std::ios_base::cur ? gptr() : egptr();
+			char* target = base + off;
+			if (target < eback() || target > egptr())
+				return pos_type(off_type(-1));
+			setg(eback(), target, egptr());
+			return pos_type(off_type(target - eback()));
+		}
+		pos_type seekpos(pos_type pos, std::ios_base::openmode which) override
+		{
+			return seekoff(off_type(pos), std::ios_base::beg, which);
+		}
+	};
+
+	class memory_istream : private memory_buffer, public std::istream
+	{
+	public:
+		memory_istream(const char* data, size_t size)
+			: memory_buffer(data, size), std::istream(static_cast<std::streambuf*>(this)) { }
+		explicit memory_istream(const mapped_file& file)
+			: memory_istream(file.data(), file.size()) { }
+	};
+
+}
+
+#endif //_LEECH_MAPPED_FILE_HPP_
@@ -4,24 +4,140 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
 #include <list>
 #include <map>
 #include <type_traits>
 #include <unordered_map>
 #include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <utility>
+#include <string>
+#include <bitset>
+#include <tuple>
 #include <string.h>
 #include <boost/preprocessor.hpp>
 
+#if defined(__has_include)
+#if __has_include(<memory_resource>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <memory_resource>
+#define LEECH_HAS_PMR 1
+#endif
+#if __has_include(<string_view>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#include <string_view>
+#define LEECH_HAS_STRING_VIEW 1
+#endif
+#endif
+
 namespace leech
 {
 
-namespace detail 
+// Attributes of a field, listed after it in the model macro as ((field), attributes...).
+namespace attributes
+{
+	struct optional_t { };
+	struct skip_write_t { };
+	struct rename_t { const char* name; };
+	struct alias_t { const char* name; };
+	template<typename T>
+	struct default_value_t { T value; };
+
+	// The field may be missing from the input.
+	constexpr optional_t optional{ };
+	// The field is read but never written.
+	constexpr skip_write_t skip_write{ };
+	// The key of the field in documents, instead of its name.
+	constexpr rename_t rename(const char* name) noexcept { return rename_t{ name }; }
+	// Another key the field is read from when its own key is missing.
+	constexpr alias_t alias(const char* name) noexcept { return alias_t{ name }; }
+	// The value given to the field when it is missing from the input; implies optional.
+	template<typename T>
+	constexpr default_value_t<T> default_value(T value) noexcept { return default_value_t<T>{ value }; }
+}
+
+namespace detail
 {
 	namespace {
 		template<typename T>
 		class struct_info;
 	}
 
+	struct no_default { };
+
+	template<typename Default>
+	struct field_attributes
+	{
+		const char* name;
+		const char* alias;
+		bool optional;
+		bool skip_write;
+		Default value;
+	};
+
+	template<typename D>
+	constexpr field_attributes<D> apply_attribute(field_attributes<D> a, attributes::optional_t) noexcept
+	{
+		a.optional = true;
+		return a;
+	}
+
+	template<typename D>
+	constexpr field_attributes<D> apply_attribute(field_attributes<D> a, attributes::skip_write_t) noexcept
+	{
+		a.skip_write = true;
+		return a;
+	}
+
+	template<typename D>
+	constexpr field_attributes<D> apply_attribute(field_attributes<D> a, attributes::rename_t rename) noexcept
+	{
+		a.name = rename.name;
+		return a;
+	}
+
+	template<typename D>
+	constexpr field_attributes<D> apply_attribute(field_attributes<D> a, attributes::alias_t alias) noexcept
+	{
+		a.alias = alias.name;
+		return a;
+	}
+
+	template<typename D, typename T>
+	constexpr field_attributes<T> apply_attribute(const field_attributes<D>& a, attributes::default_value_t<T> d) noexcept
+	{
+		return field_attributes<T>{ a.name, a.alias, true, a.skip_write, d.value };
+	}
+
+	template<typename D>
+	constexpr field_attributes<D> fold_attributes(const field_attributes<D>& a) noexcept
+	{
+		return a;
+	}
+
+	template<typename D, typename A, typename... Rest>
+	constexpr auto fold_attributes(const field_attributes<D>& a, const A& attribute, const Rest&... rest) noexcept
+	{
+		return fold_attributes(apply_attribute(a, attribute), rest...);
+	}
+
+	// The attributes of the field name, evaluated at compile time by the model macros.
+	template<typename... Attributes>
+	constexpr auto make_attributes(const char* name, const Attributes&... attributes) noexcept
+	{
+		return fold_attributes(field_attributes<no_default>{ name, nullptr, false, false, no_default{ } }, attributes...);
+	}
+
+	// For fields declared outside the model macros; the name is the one given to the field.
+	struct no_attributes
+	{
+		static constexpr field_attributes<no_default> get() noexcept
+		{
+			return field_attributes<no_default>{ nullptr, nullptr, false, false, no_default{ } };
+		}
+	};
+
 	template<typename T, typename M>
 	struct setter
 	{
@@ -92,26 +208,36 @@ namespace detail
 		}
 	};
 
-	template<typename T, typename Getter, typename Setter>
+	template<typename T, typename Getter, typename Setter, typename Attributes = no_attributes>
 	struct struct_field
 	{
 	public:
 		typedef std::remove_cv_t<std::remove_reference_t<typename std::result_of<Getter(T&)>::type>> value_type;
+		// True when the getter exposes the member itself, so it can be decoded in place.
+		typedef std::is_same<typename std::result_of<const Getter&(T&)>::type, value_type&> in_place;
 		template<size_t N>
 		struct_field(const char(&name)[N], const Getter& getter, const Setter& setter) noexcept
-			: _name(name), _setter(setter), _getter(getter), _optional(false) { }
-		const char* name() const noexcept { return _name; }
+			: _name(name), _setter(setter), _getter(getter) { }
+		// The key of the field in documents.
+		const char* name() const noexcept { return Attributes::get().name ? Attributes::get().name : _name; }
 		
 		template<typename = std::enable_if<!std::is_same<Getter, std::nullptr_t>::value>>
 		decltype(auto) get_value(const T& v) const { return _getter(v); }
 		template<typename = std::enable_if<!std::is_same<Setter, std::nullptr_t>::value>>
-		void set_value(T& v, const value_type& f) { _setter(v, f); }
-		bool optional() const noexcept { return _optional;  }
-		void optional(bool v) noexcept { _optional = v; }
+		void set_value(T& v, const value_type& f) const { _setter(v, f); }
+		// The attributes are constants of the model, so the checks on them fold away.
+		static constexpr bool optional() noexcept { return Attributes::get().optional; }
+		static constexpr bool skip_write() noexcept { return Attributes::get().skip_write; }
+		static constexpr const char* alias() noexcept { return Attributes::get().alias; }
+		// Gives the field its default value, if it has one.
+		void set_default(T& v) const { assign_default(v, Attributes::get().value); }
 		template<typename Document>
 		void put(Document& doc, typename Document::element_type& element, const T& v) const;
 		template<typename Document>
 		void get(const Document& doc, const typename Document::element_type& element, T& v) const;
+		// Decodes the field from its child element, which the caller has already looked up.
+		template<typename Document>
+		void get_child(const Document& doc, const typename Document::element_type& child, T& v) const;
 		template<typename Pred>
 		void visit(const T& v, Pred&& pred) const;
 		template<typename Pred>
@@ -121,34 +247,52 @@ namespace detail
 		const char* _name;
 		Setter _setter;
 		Getter _getter;
-		bool _optional;
+
+	private:
+		void assign_default(T&, no_default) const noexcept { }
+		template<typename D>
+		void assign_default(T& v, const D& value) const { _setter(v, value_type(value)); }
+		template<typename Document>
+		void decode(const Document& doc, const typename Document::element_type& child, T& v, std::true_type) const;
+		template<typename Document>
+		void decode(const Document& doc, const typename Document::element_type& child, T& v, std::false_type) const;
 	};
 
-	template<typename T, typename M>
-	struct struct_data_field : public struct_field<T, getter<T, M>, setter<T, M>>
+	template<typename T, typename M, typename Attributes = no_attributes>
+	struct struct_data_field : public struct_field<T, getter<T, M>, setter<T, M>, Attributes>
 	{
 		template<size_t N>
 		struct_data_field(const char(&name)[N], M T::*m) noexcept
-			: struct_field<T, getter<T, M>, setter<T, M>>(name, getter<T, M>(m), setter<T, M>(m)) { }
+			: struct_field<T, getter<T, M>, setter<T, M>, Attributes>(name, getter<T, M>(m), setter<T, M>(m)) { }
 		const M& get_value(const T& v) const noexcept { return this->_getter(v); }
 		M& get_value(T& v) const noexcept { return this->_getter(v); }
-		void set_value(T& v, const M& f) noexcept { this->_setter(v, f); }
-		void set_value(T& v, M&& f) noexcept { this->_setter(v, std::forward<M>(f)); }
+		void set_value(T& v, const M& f) const noexcept { this->_setter(v, f); }
+		void set_value(T& v, M&& f) const noexcept { this->_setter(v, std::forward<M>(f)); }
 	};
 
-	template<typename Tuple, size_t I>
-	struct struct_tuple_field : public struct_field<Tuple, tuple_getter<Tuple, I>, tuple_setter<Tuple, I>>
+	template<typename Tuple, size_t I, typename Attributes = no_attributes>
+	struct struct_tuple_field : public struct_field<Tuple, tuple_getter<Tuple, I>, tuple_setter<Tuple, I>, Attributes>
 	{
-		typedef struct_field<Tuple, tuple_getter<Tuple, I>, tuple_setter<Tuple, I>> base_class;
+		typedef struct_field<Tuple, tuple_getter<Tuple, I>, tuple_setter<Tuple, I>, Attributes> base_class;
 		template<size_t N>
 		struct_tuple_field(const char(&name)[N]) noexcept
-			: struct_field<Tuple, tuple_getter<Tuple, I>, tuple_setter<Tuple, I>>(name, tuple_getter<Tuple, I>(), tuple_setter<Tuple, I>()) { }
+			: base_class(name, tuple_getter<Tuple, I>(), tuple_setter<Tuple, I>()) { }
 		const typename base_class::value_type& get_value(const Tuple& v) const noexcept { return this->_getter(v); }
 		typename base_class::value_type& get_value(Tuple& v) const noexcept { return this->_getter(v); }
-		void set_value(Tuple& v, const typename base_class::value_type& f) noexcept { this->_setter(v, f); }
-		void set_value(Tuple& v, typename base_class::value_type&& f) noexcept { this->_setter(v, std::forward<base_class::value_type>(f)); }
+		void set_value(Tuple& v, const typename base_class::value_type& f) const noexcept { this->_setter(v, f); }
+		void set_value(Tuple& v, typename base_class::value_type&& f) const noexcept { this->_setter(v, std::forward<typename base_class::value_type>(f)); }
 	};
 
+	// FNV-1a hash of a field name. It is usable in constant expressions, so the
+	// model macros switch over the hashes of the field names at compile time.
+	constexpr std::uint64_t name_hash(const char* name) noexcept
+	{
+		std::uint64_t hash = 14695981039346656037ull;
+		for (; *name; ++name)
+			hash = (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull;
+		return hash;
+	}
+
 	template<typename>
 	struct field_type;
 
@@ -172,6 +316,167 @@ namespace detail
 template<typename T>
 struct is_reflected : public std::integral_constant<bool, false> { };
 
+// Type tag of a field in its descriptor.
+enum class field_kind : std::uint8_t { boolean, integer, floating, string, sequence, map, object, other };
+
+enum field_flags : std::uint32_t
+{
+	field_optional = 1,
+	field_inherited = 2,
+	field_skip_write = 4
+};
+
+// One entry of the constexpr field table that STRUCT_MODEL emits for each model,
+// for table-driven code that indexes fields without instantiating per-field templates.
+struct field_descriptor
+{
+	static constexpr size_t npos = static_cast<size_t>(-1);
+
+	const char* name;
+	size_t length;
+	std::uint64_t hash;
+	// Byte offset of a data member in the model type, npos for getter/setter and tuple fields.
+	size_t offset;
+	field_kind kind;
+	std::uint32_t flags;
+};
+
+namespace detail
+{
+	template<typename T, typename = void>
+	struct kind_of : public std::integral_constant<field_kind, field_kind::other> { };
+
+	template<>
+	struct kind_of<bool> : public std::integral_constant<field_kind, field_kind::boolean> { };
+
+	template<typename T>
+	struct kind_of<T, typename std::enable_if<(std::is_integral<T>::value || std::is_enum<T>::value) && !std::is_same<T, bool>::value>::type>
+		: public std::integral_constant<field_kind, field_kind::integer> { };
+
+	template<typename T>
+	struct kind_of<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+		: public std::integral_constant<field_kind, field_kind::floating> { };
+
+	template<typename Char, typename Traits, typename Allocator>
+	struct kind_of<std::basic_string<Char, Traits, Allocator>> : public std::integral_constant<field_kind, field_kind::string> { };
+
+#ifdef LEECH_HAS_STRING_VIEW
+	template<typename Char, typename Traits>
+	struct kind_of<std::basic_string_view<Char, Traits>> : public std::integral_constant<field_kind, field_kind::string> { };
+#endif
+
+	template<typename T, typename Allocator>
+	struct kind_of<std::vector<T, Allocator>> : public std::integral_constant<field_kind, field_kind::sequence> { };
+
+	template<typename T, typename Allocator>
+	struct kind_of<std::list<T, Allocator>> : public std::integral_constant<field_kind, field_kind::sequence> { };
+
+	template<typename K, typename T, typename Compare, typename Allocator>
+	struct kind_of<std::map<K, T, Compare, Allocator>> : public std::integral_constant<field_kind, field_kind::map> { };
+
+	template<typename K, typename T, typename Hash, typename Equal, typename Allocator>
+	struct kind_of<std::unordered_map<K, T, Hash, Equal, Allocator>> : public std::integral_constant<field_kind, field_kind::map> { };
+
+	template<typename T>
+	struct kind_of<T, typename std::enable_if<is_reflected<T>::value>::type> : public std::integral_constant<field_kind, field_kind::object> { };
+
+	constexpr size_t name_length(const char* name) noexcept
+	{
+		size_t length = 0;
+		while (name[length]) ++length;
+		return length;
+	}
+
+	template<typename Default>
+	constexpr field_descriptor make_descriptor(const field_attributes<Default>& a, size_t offset, field_kind kind) noexcept
+	{
+		return field_descriptor{ a.name, name_length(a.name), name_hash(a.name), offset, kind,
+			static_cast<std::uint32_t>((a.optional ? field_optional : field_flags(0)) | (a.skip_write ? field_skip_write : field_flags(0))) };
+	}
+
+	constexpr field_descriptor inherited(const field_descriptor& d) noexcept
+	{
+		return field_descriptor{ d.name, d.length, d.hash, d.offset, d.kind, d.flags | field_inherited };
+	}
+
+	template<size_t N, size_t... I>
+	constexpr std::array<field_descriptor, N> inherited(const std::array<field_descriptor, N>& a, std::index_sequence<I...>) noexcept
+	{
+		return std::array<field_descriptor, N>{ { inherited(a[I])... } };
+	}
+
+	// The fields of a base model, flagged as inherited.
+	template<size_t N>
+	constexpr std::array<field_descriptor, N> inherited(const std::array<field_descriptor, N>& a) noexcept
+	{
+		return inherited(a, std::make_index_sequence<N>());
+	}
+
+	template<size_t N, size_t M, size_t... I, size_t... J>
+	constexpr std::array<field_descriptor, N + M> join_descriptors(const std::array<field_descriptor, N>& a,
+		const std::array<field_descriptor, M>& b, std::index_sequence<I...>, std::index_sequence<J...>) noexcept
+	{
+		return std::array<field_descriptor, N + M>{ { a[I]..., b[J]... } };
+	}
+
+	template<size_t N>
+	constexpr std::array<field_descriptor, N> join_descriptors(const std::array<field_descriptor, N>& a) noexcept
+	{
+		return a;
+	}
+
+	template<size_t N, size_t M, typename... Rest>
+	constexpr auto join_descriptors(const std::array<field_descriptor, N>& a, const std::array<field_descriptor, M>& b, const Rest&... rest) noexcept
+	{
+		return join_descriptors(join_descriptors(a, b, std::make_index_sequence<N>(), std::make_index_sequence<M>()), rest...);
+	}
+}
+
+namespace detail
+{
+	template<typename...>
+	struct make_void { typedef void type; };
+
+	// Detects the optional has_child(element, name) hook of a document,
+	// which tells a missing child apart without throwing.
+	template<typename Document, typename = void>
+	struct has_child_hook : public std::false_type { };
+
+	template<typename Document>
+	struct has_child_hook<Document, typename make_void<decltype(std::declval<const Document&>().has_child(
+		std::declval<const typename Document::element_type&>(), std::declval<const char*>()))>::type> : public std::true_type { };
+
+	template<typename Document>
+	inline bool missing_child(std::true_type, const Document& doc, const typename Document::element_type& element, const char* name)
+	{
+		return !doc.has_child(element, name);
+	}
+
+	template<typename Document>
+	inline bool missing_child(std::false_type, const Document&, const typename Document::element_type&, const char*) noexcept
+	{
+		return false;
+	}
+
+	// Detects the optional for_each_child(element, fn) hook of a document,
+	// which walks the members of an element in the order they were read.
+	template<typename Document, typename = void>
+	struct for_each_child_hook : public std::false_type { };
+
+	template<typename Document>
+	struct for_each_child_hook<Document, typename make_void<decltype(std::declval<const Document&>().for_each_child(
+		std::declval<const typename Document::element_type&>(),
+		std::declval<void(*)(const char*, const typename Document::element_type&)>()))>::type> : public std::true_type { };
+
+	// Detects documents without keys, which declare a positional type such as std::true_type:
+	// their fields are read back in the order they were written.
+	template<typename Document, typename = void>
+	struct positional_document : public std::false_type { };
+
+	template<typename Document>
+	struct positional_document<Document, typename make_void<typename Document::positional>::type> : public Document::positional { };
+}
+
 namespace detail 
 {
 
@@ -303,6 +608,318 @@ inline constexpr bool find_field(size_t index, Pred&& pred)
 	return detail::struct_info<S>::instance().find_field(index, std::forward<Pred>(pred));
 }
 
+template<typename S, typename Pred>
+inline void for_each_field(Pred&& pred)
+{
+	detail::struct_info<S>::instance().for_each_field(std::forward<Pred>(pred));
+}
+
+// The descriptors of the fields of S, inherited fields first, as a constexpr std::array.
+template<typename S>
+constexpr auto field_table = detail::struct_info<S>::template descriptors<S>();
+
+template<typename S>
+inline constexpr const auto& field_descriptors() noexcept
+{
+	return field_table<S>;
+}
+
+namespace detail
+{
+	// The index of a field in field_table<S>. Every field of a model has its own type,
+	// so the index is found once per field.
+	template<typename S, typename Field>
+	inline size_t field_index()
+	{
+		static const size_t index = []() {
+			size_t result = 0, i = 0;
+			for_each_field<S>([&](const auto& field) {
+				if (std::is_same<std::decay_t<decltype(field)>, Field>::value) result = i;
+				++i;
+			});
+			return result;
+		}();
+		return index;
+	}
+
+	// The index in field_table<S> of the field with the key name, found through the hashed
+	// lookup of find_field, aliases included; key is set to the key or alias it matched,
+	// which outlives any document. npos and nullptr if S has no such field.
+	template<typename S>
+	inline size_t find_field_index(const char* name, const char*& key) noexcept
+	{
+		size_t index = field_descriptor::npos;
+		key = nullptr;
+		find_field<S>(name, [&](const auto& field) {
+			index = field_index<S, std::decay_t<decltype(field)>>();
+			key = strcmp(field.name(), name) == 0 ? field.name() : field.alias();
+		});
+		return index;
+	}
+
+	template<typename S>
+	inline size_t find_field_index(const char* name) noexcept
+	{
+		const char* key;
+		return find_field_index<S>(name, key);
+	}
+}
+
+// Looks up a descriptor by key or alias, nullptr if S has no such field.
+template<typename S>
+inline const field_descriptor* find_descriptor(const char* name) noexcept
+{
+	size_t index = detail::find_field_index<S>(name);
+	return index == field_descriptor::npos ? nullptr : &field_table<S>[index];
+}
+
+namespace detail
+{
+#ifdef LEECH_HAS_PMR
+	inline std::pmr::memory_resource*& current_resource() noexcept
+	{
+		static thread_local std::pmr::memory_resource* resource = nullptr;
+		return resource;
+	}
+
+	template<typename T>
+	inline void bind_resource(T& v, std::true_type)
+	{
+		std::pmr::memory_resource* resource = current_resource();
+		if (resource && v.get_allocator().resource() != resource)
+		{
+			T rebound(std::move(v), typename T::allocator_type(resource));
+			v.~T();
+			new (&v) T(std::move(rebound));
+		}
+	}
+
+	template<typename T>
+	inline void bind_resource(T&, std::false_type) noexcept { }
+
+	// Moves a std::pmr member onto the resource of the current decode_context before
+	// it is decoded, so what is decoded into it is allocated there too.
+	template<typename T>
+	inline void bind_resource(T& v)
+	{
+		bind_resource(v, std::uses_allocator<T, std::pmr::polymorphic_allocator<char>>());
+	}
+#else
+	template<typename T>
+	inline void bind_resource(T&) noexcept { }
+#endif
+}
+
+#ifdef LEECH_HAS_PMR
+// Makes get on this thread allocate std::pmr members of reflected structs from resource
+// while the context is alive, e.g. from a std::pmr::monotonic_buffer_resource that is
+// released at once with the whole decoded object. Contexts nest.
+class decode_context
+{
+public:
+	explicit decode_context(std::pmr::memory_resource* resource) noexcept
+		: _resource(resource), _previous(detail::current_resource())
+	{
+		detail::current_resource() = resource;
+	}
+	decode_context(const decode_context&) = delete;
+	decode_context& operator=(const decode_context&) = delete;
+	~decode_context() { detail::current_resource() = _previous; }
+
+	std::pmr::memory_resource* resource() const noexcept { return _resource; }
+
+private:
+	std::pmr::memory_resource* _resource;
+	std::pmr::memory_resource* _previous;
+};
+#endif
+
+namespace detail
+{
+	// Finds the I-th field in field_table order at compile time: inherited fields are
+	// in the bases, in order, followed by the own fields of the model.
+	template<size_t I, typename Info, typename Bases = typename Info::base_types>
+	struct field_locator;
+
+	template<size_t I, typename Info>
+	struct field_locator<I, Info, std::tuple<>>
+	{
+		static const auto& get(const Info& info) noexcept
+		{
+			return info.own_field(std::integral_constant<size_t, I>());
+		}
+	};
+
+	template<size_t I, typename Info, typename Base, typename... Rest>
+	struct field_locator<I, Info, std::tuple<Base, Rest...>>
+	{
+		static const auto& get(const Info& info) noexcept
+		{
+			return get(info, std::integral_constant<bool, (I < Base::total_count)>());
+		}
+		static const auto& get(const Base& info, std::true_type) noexcept
+		{
+			return field_locator<I, Base>::get(info);
+		}
+		static const auto& get(const Info& info, std::false_type) noexcept
+		{
+			return field_locator<I - Base::total_count, Info, std::tuple<Rest...>>::get(info);
+		}
+	};
+
+	// One entry per field in field_table order, so an index reaches an inherited field with
+	// a single indirect call instead of a test per base.
+	template<typename Info, typename Pred>
+	struct field_dispatch
+	{
+		typedef void (*entry)(const Info&, Pred&);
+		template<size_t I>
+		static void call(const Info& info, Pred& pred) { pred(field_locator<I, Info>::get(info)); }
+		template<size_t... I>
+		static constexpr std::array<entry, sizeof...(I)> make(std::index_sequence<I...>) noexcept { return { { &call<I>... } }; }
+		static constexpr std::array<entry, Info::total_count> table = make(std::make_index_sequence<Info::total_count>());
+
+		static bool find(const Info& info, size_t index, Pred& pred)
+		{
+			if (index >= Info::total_count) return false;
+			table[index](info, pred);
+			return true;
+		}
+	};
+
+	template<typename Info, typename Pred>
+	constexpr std::array<typename field_dispatch<Info, Pred>::entry, Info::total_count> field_dispatch<Info, Pred>::table;
+
+	// A key a field is found under, its own or an alias, with its index in field_table order.
+	struct field_key
+	{
+		std::uint64_t hash;
+		const char* key;
+		size_t index;
+	};
+
+	template<size_t N>
+	struct field_keys
+	{
+		field_key keys[N];
+		size_t size;
+	};
+
+	// The keys of a model sorted by hash at compile time, the keys of the fields before
+	// the aliases. With Names it holds every key of the model and of its bases, so an
+	// inherited model finds any field with one search; without, only the aliases, which
+	// the switch over the own keys of a model leaves to it.
+	template<typename Info, bool Names>
+	struct key_table
+	{
+		static constexpr size_t capacity = (Names ? 2 : 1) * Info::total_count;
+
+		template<size_t I>
+		using field_at = std::decay_t<decltype(field_locator<I, Info>::get(std::declval<const Info&>()))>;
+
+		static constexpr void insert(field_keys<capacity>& result, const field_key& key) noexcept
+		{
+			size_t i = result.size++;
+			for (; i != 0 && result.keys[i - 1].hash > key.hash; --i)
+				result.keys[i] = result.keys[i - 1];
+			result.keys[i] = key;
+		}
+		template<size_t... I>
+		static constexpr field_keys<capacity> make(std::index_sequence<I...>) noexcept
+		{
+			const char* const aliases[] = { field_at<I>::alias()... };
+			const auto& table = field_table<typename Info::struct_type>;
+			field_keys<capacity> result{ };
+			for (size_t i = 0; Names && i != table.size(); i++)
+				insert(result, field_key{ table[i].hash, table[i].name, i });
+			for (size_t i = 0; i != table.size(); i++)
+			{
+				if (aliases[i])
+					insert(result, field_key{ name_hash(aliases[i]), aliases[i], i });
+			}
+			return result;
+		}
+		static constexpr field_keys<capacity> keys = make(std::make_index_sequence<Info::total_count>());
+
+		template<typename Pred>
+		static bool find(const Info& info, const char* name, std::uint64_t hash, Pred& pred)
+		{
+			const field_key* last = keys.keys + keys.size;
+			const field_key* it = std::lower_bound(keys.keys, last, hash,
+				[](const field_key& key, std::uint64_t h) noexcept { return key.hash < h; });
+			for (; it != last && it->hash == hash; ++it)
+			{
+				if (strcmp(it->key, name) == 0)
+					return field_dispatch<Info, Pred>::find(info, it->index, pred);
+			}
+			return false;
+		}
+	};
+
+	template<typename Info, bool Names>
+	constexpr field_keys<key_table<Info, Names>::capacity> key_table<Info, Names>::keys;
+}
+
+// Hits and misses of the key order that get_ordered predicts for a model type.
+struct key_order_stats
+{
+	size_t hits;
+	size_t misses;
+};
+
+namespace detail
+{
+	// The key order last decoded for S on this thread: the index in field_table<S>
+	// of the member at each position, npos for a key that is not a field, and the key
+	// or alias it was found under, nullptr for a key that is not a field.
+	template<typename S>
+	struct key_order
+	{
+		std::vector<size_t> fields;
+		std::vector<const char*> keys;
+		key_order_stats stats;
+	};
+
+	template<typename S>
+	inline key_order<S>& key_order_state() noexcept
+	{
+		static thread_local key_order<S> state{ };
+		return state;
+	}
+
+	template<typename Document, typename S>
+	inline void get_ordered(std::false_type, const Document& doc, const typename Document::element_type& element, S& v)
+	{
+		leech::get(doc, element, v);
+	}
+
+	template<typename Document, typename S>
+	inline void get_ordered(std::true_type, const Document& doc, const typename Document::element_type& element, S& v);
+}
+
+template<typename Document, typename S>
+inline typename std::enable_if<is_reflected<S>::value>::type get_ordered(const Document& doc, const typename Document::element_type& element, S& v)
+{
+	detail::get_ordered(detail::for_each_child_hook<Document>(), doc, element, v);
+}
+
+// Decodes like get, but walks the members of the input in order and checks the field
+// that was at the same position last time before looking the key up, which makes
+// decoding many documents with the same key order a linear scan. Reflected data members
+// are decoded the same way; documents without a for_each_child hook fall back to get.
+template<typename Document, typename S>
+inline void get_ordered(const Document& doc, S& v)
+{
+	get_ordered(doc, doc.root(), v);
+}
+
+// The prediction counters of get_ordered for S on the calling thread.
+template<typename S>
+inline key_order_stats& key_order_statistics() noexcept
+{
+	return detail::key_order_state<S>().stats;
+}
+
 template<typename S, typename T>
 inline bool assign(S& s, const char* name, const T& v)
 {
@@ -335,10 +952,20 @@ inline bool assign(S& s, size_t index, T&& v)
 	});
 }
 
+// The number of fields of S, inherited ones included.
 template<typename S>
-inline constexpr void field_count()
+inline constexpr size_t field_count() noexcept
+{
+	return detail::struct_info<S>::total_count;
+}
+
+// The value of the I-th field of s, in field_table order, without any dispatch at run time.
+template<size_t I, typename S>
+inline decltype(auto) get_field(S& s)
 {
-	return detail::struct_info<S>::field_count;
+	typedef detail::struct_info<std::remove_const_t<S>> info;
+	static_assert(I < info::total_count, "field index out of range");
+	return detail::field_locator<I, info>::get(info::instance()).get_value(s);
 }
 
 template<typename T, typename Pred>
@@ -365,35 +992,174 @@ inline typename std::enable_if<is_reflected<T>::value>::type visit(const char* n
 namespace detail
 {
 
-template<typename T, typename Getter, typename Setter> template<typename Document>
-inline void struct_field<T, Getter, Setter>::put(Document& doc, typename Document::element_type& element, const T& v) const
+template<typename T, typename Getter, typename Setter, typename Attributes> template<typename Document>
+inline void struct_field<T, Getter, Setter, Attributes>::put(Document& doc, typename Document::element_type& element, const T& v) const
 {
-	leech::put(doc, doc.child(element, name()), get_value(v), name());
+	if (skip_write()) return;
+	// Backends such as yaml and config return children by value.
+	auto&& child = doc.child(element, name());
+	leech::put(doc, child, get_value(v), name());
 }
 
-template<typename T, typename Getter, typename Setter> template<typename Document>
-inline void struct_field<T, Getter, Setter>::get(const Document& doc, const typename Document::element_type& element, T& v) const
+template<typename T, typename Getter, typename Setter, typename Attributes> template<typename Document>
+inline void struct_field<T, Getter, Setter, Attributes>::get(const Document& doc, const typename Document::element_type& element, T& v) const
 {
+	// A document without keys never has the fields that were not written.
+	if (skip_write() && positional_document<Document>::value)
+	{
+		set_default(v);
+		return;
+	}
+	// A required field without an alias is looked up once; the document reports it missing.
+	const char* key = name();
+	if ((optional() || alias()) && missing_child(has_child_hook<Document>(), doc, element, key))
+	{
+		if (alias() && !missing_child(has_child_hook<Document>(), doc, element, alias()))
+			key = alias();
+		else if (optional())
+		{
+			set_default(v);
+			return;
+		}
+	}
 	try
 	{
-		value_type field_value;
-		leech::get(doc, doc.child(element, name()), field_value, name());
-		_setter(v, std::move(field_value));
+		decode(doc, doc.child(element, key), v, in_place());
 	}
 	catch (std::exception&)
 	{
 		if (!optional()) throw;
+		set_default(v);
 	}
 }
 
-template<typename T, typename Getter, typename Setter> template<typename Pred>
-inline void struct_field<T, Getter, Setter>::visit(const T& v, Pred&& pred) const
+template<typename T, typename Getter, typename Setter, typename Attributes> template<typename Document>
+inline void struct_field<T, Getter, Setter, Attributes>::get_child(const Document& doc, const typename Document::element_type& child, T& v) const
+{
+	try
+	{
+		decode(doc, child, v, in_place());
+	}
+	catch (std::exception&)
+	{
+		// As in get, an optional field that does not decode takes its default value.
+		if (!optional()) throw;
+		set_default(v);
+	}
+}
+
+template<typename T, typename Getter, typename Setter, typename Attributes> template<typename Document>
+inline void struct_field<T, Getter, Setter, Attributes>::decode(const Document& doc, const typename Document::element_type& child, T& v, std::true_type) const
+{
+	auto& value = _getter(v);
+	bind_resource(value);
+	leech::get(doc, child, value, name());
+}
+
+template<typename T, typename Getter, typename Setter, typename Attributes> template<typename Document>
+inline void struct_field<T, Getter, Setter, Attributes>::decode(const Document& doc, const typename Document::element_type& child, T& v, std::false_type) const
+{
+	value_type field_value;
+	bind_resource(field_value);
+	leech::get(doc, child, field_value, name());
+	_setter(v, std::move(field_value));
+}
+
+template<typename Document, typename S, typename T, typename M, typename A>
+inline void get_ordered_member(std::false_type, const Document& doc, const typename Document::element_type& child, const struct_data_field<T, M, A>& field, S& v)
+{
+	field.get_child(doc, child, v);
+}
+
+template<typename Document, typename S, typename T, typename M, typename A>
+inline void get_ordered_member(std::true_type, const Document& doc, const typename Document::element_type& child, const struct_data_field<T, M, A>& field, S& v)
+{
+	try
+	{
+		leech::get_ordered(doc, child, field.get_value(static_cast<T&>(v)));
+	}
+	catch (std::exception&)
+	{
+		if (!field.optional()) throw;
+		field.set_default(static_cast<T&>(v));
+	}
+}
+
+template<typename Document, typename S, typename Field>
+inline void get_ordered_field(const Document& doc, const typename Document::element_type& child, const Field& field, S& v)
+{
+	field.get_child(doc, child, v);
+}
+
+template<typename Document, typename S, typename T, typename M, typename A>
+inline void get_ordered_field(const Document& doc, const typename Document::element_type& child, const struct_data_field<T, M, A>& field, S& v)
+{
+	get_ordered_member(is_reflected<M>(), doc, child, field, v);
+}
+
+template<typename Document, typename S>
+inline void get_ordered(std::true_type, const Document& doc, const typename Document::element_type& element, S& v)
+{
+	const auto& table = field_table<S>;
+	key_order<S>& order = key_order_state<S>();
+	std::bitset<field_table<S>.size()> seen;
+	size_t position = 0;
+	doc.for_each_child(element, [&](const char* name, const typename Document::element_type& child) {
+		size_t index;
+		if (position < order.fields.size() && (order.keys[position] ?
+			strcmp(order.keys[position], name) == 0 : find_field_index<S>(name) == field_descriptor::npos))
+		{
+			index = order.fields[position];
+			++order.stats.hits;
+		}
+		else
+		{
+			const char* key;
+			index = find_field_index<S>(name, key);
+			if (position < order.fields.size())
+			{
+				order.fields[position] = index;
+				order.keys[position] = key;
+			}
+			else
+			{
+				order.fields.push_back(index);
+				order.keys.push_back(key);
+			}
+			++order.stats.misses;
+		}
+		++position;
+		if (index == field_descriptor::npos || seen[index])
+			return;
+		seen.set(index);
+		struct_info<S>::instance().find_field(index, [&](const auto& field) {
+			get_ordered_field(doc, child, field, v);
+		});
+	});
+	// Fields missing from the input go through get, which skips optional fields and
+	// lets the document report a missing required one.
+	if (!seen.all())
+	{
+		for (size_t i = 0; i != table.size(); i++)
+		{
+			if (!seen[i])
+			{
+				struct_info<S>::instance().find_field(i, [&](const auto& field) {
+					field.get(doc, element, v);
+				});
+			}
+		}
+	}
+}
+
+template<typename T, typename Getter, typename Setter, typename Attributes> template<typename Pred>
+inline void struct_field<T, Getter, Setter, Attributes>::visit(const T& v, Pred&& pred) const
 {
 	leech::visit(name(), get_value(v), std::forward<Pred>(pred));
 }
 
-template<typename T, typename Getter, typename Setter> template<typename Pred>
-inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
+template<typename T, typename Getter, typename Setter, typename Attributes> template<typename Pred>
+inline void struct_field<T, Getter, Setter, Attributes>::visit(T&& v, Pred&& pred) const
 {
 	leech::visit(name(), get_value(std::forward<T>(v)), std::forward<Pred>(pred));
 }
@@ -403,6 +1169,8 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 }
 
 // Usage: STRUCT_MODEL(MyStruct, a, b, c)
+// A field with attributes is written as ((a), optional, rename("key")),
+// or ((a, get_a, set_a), ...) for one read through accessors.
 
 #ifndef STRUCT_MODEL_FIELD_PREFIX
 #define STRUCT_MODEL_FIELD_PREFIX
@@ -412,9 +1180,40 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 #define STRUCT_MODEL_FIELD_SUFFIX
 #endif //STRUCT_MODEL_FIELD_SUFFIX
 
-#define STRUCT_MODEL_UNBOX(var) \
+#define STRUCT_MODEL_UNBOX_I(var) \
 	BOOST_PP_IIF(BOOST_PP_IS_BEGIN_PARENS(var), BOOST_PP_TUPLE_ELEM(0, var), var)
 
+#define STRUCT_MODEL_UNBOX(var) \
+	STRUCT_MODEL_UNBOX_I(STRUCT_MODEL_UNBOX_I(var))
+
+#define STRUCT_MODEL_FALSE(var) 0
+
+#define STRUCT_MODEL_HAS_ATTRIBUTES_I(field) \
+	BOOST_PP_IS_BEGIN_PARENS(BOOST_PP_TUPLE_ELEM(0, field))
+
+#define STRUCT_MODEL_HAS_ATTRIBUTES(field) \
+	BOOST_PP_IIF(BOOST_PP_IS_BEGIN_PARENS(field), STRUCT_MODEL_HAS_ATTRIBUTES_I, STRUCT_MODEL_FALSE)(field)
+
+#define STRUCT_MODEL_SPEC_NONE(field) field
+
+#define STRUCT_MODEL_SPEC_II(spec) \
+	BOOST_PP_IIF(BOOST_PP_EQUAL(BOOST_PP_TUPLE_SIZE(spec), 1), BOOST_PP_TUPLE_ELEM(0, spec), spec)
+
+#define STRUCT_MODEL_SPEC_I(field) \
+	STRUCT_MODEL_SPEC_II(BOOST_PP_TUPLE_ELEM(0, field))
+
+// The field without its attributes: a name, or a tuple of a name and accessors.
+#define STRUCT_MODEL_SPEC(field) \
+	BOOST_PP_IIF(STRUCT_MODEL_HAS_ATTRIBUTES(field), STRUCT_MODEL_SPEC_I, STRUCT_MODEL_SPEC_NONE)(field)
+
+#define STRUCT_MODEL_ATTRIBUTE_LIST_NONE(field)
+
+#define STRUCT_MODEL_ATTRIBUTE_LIST_I(field) \
+	, BOOST_PP_TUPLE_ENUM(BOOST_PP_TUPLE_POP_FRONT(field))
+
+#define STRUCT_MODEL_ATTRIBUTE_LIST(field) \
+	BOOST_PP_IIF(STRUCT_MODEL_HAS_ATTRIBUTES(field), STRUCT_MODEL_ATTRIBUTE_LIST_I, STRUCT_MODEL_ATTRIBUTE_LIST_NONE)(field)
+
 #define STRUCT_MODEL_FIELD_NAME(field)  \
 	BOOST_PP_STRINGIZE(STRUCT_MODEL_UNBOX(field))
 
@@ -443,18 +1242,36 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 #define STRUCT_MODEL_FIELDVAR_EX(i, fields) \
 	STRUCT_MODEL_FIELDVAR(BOOST_PP_TUPLE_ELEM(i, fields))
 
-#define STRUCT_MODEL_INIT_DATA_FIELD(classname, field) \
-	struct_data_field<classname, typename field_type<decltype(STRUCT_MODEL_FIELD(classname, field))>::type> STRUCT_MODEL_FIELDVAR(field) \
+#define STRUCT_MODEL_ATTRIBUTES(field) \
+	BOOST_PP_CAT(STRUCT_MODEL_FIELDVAR(field), _attributes)
+
+#define STRUCT_MODEL_ATTRIBUTES_EX(i, fields) \
+	STRUCT_MODEL_ATTRIBUTES(BOOST_PP_TUPLE_ELEM(i, fields))
+
+// A constant of the attributes of each field, which the field types take as a parameter.
+#define STRUCT_MODEL_INIT_ATTRIBUTES(z, i, fields) \
+	struct STRUCT_MODEL_ATTRIBUTES_EX(i, fields) { \
+		static constexpr auto get() noexcept { \
+			using namespace leech::attributes; \
+			return make_attributes(STRUCT_MODEL_FIELD_NAME(BOOST_PP_TUPLE_ELEM(i, fields)) STRUCT_MODEL_ATTRIBUTE_LIST(BOOST_PP_TUPLE_ELEM(i, fields))); \
+		} \
+	};
+
+#define STRUCT_MODEL_INIT_DATA_FIELD(classname, field, attributes) \
+	struct_data_field<classname, typename field_type<decltype(STRUCT_MODEL_FIELD(classname, field))>::type, attributes> STRUCT_MODEL_FIELDVAR(field) \
 	{ STRUCT_MODEL_FIELD_NAME(field), STRUCT_MODEL_FIELD(classname, field) };
 
-#define STRUCT_MODEL_INIT_SETTER_GETTER(classname, fields) \
-		struct_field<classname, decltype(STRUCT_MODEL_GETTER(classname, fields)), decltype(STRUCT_MODEL_SETTER(classname, fields))> STRUCT_MODEL_FIELDVAR(fields) \
+#define STRUCT_MODEL_INIT_SETTER_GETTER(classname, fields, attributes) \
+		struct_field<classname, decltype(STRUCT_MODEL_GETTER(classname, fields)), decltype(STRUCT_MODEL_SETTER(classname, fields)), attributes> STRUCT_MODEL_FIELDVAR(fields) \
 		{ STRUCT_MODEL_FIELD_NAME(fields), STRUCT_MODEL_GETTER(classname, fields), STRUCT_MODEL_SETTER(classname, fields) };
 
-#define STRUCT_MODEL_INIT_FIELD_IMPL(classname, fields) \
-	BOOST_PP_TUPLE_ENUM(BOOST_PP_IIF(BOOST_PP_IS_BEGIN_PARENS(fields), \
-		(STRUCT_MODEL_INIT_SETTER_GETTER(classname, fields)), \
-		(STRUCT_MODEL_INIT_DATA_FIELD(classname, fields))))
+#define STRUCT_MODEL_INIT_FIELD_SPEC(classname, spec, attributes) \
+	BOOST_PP_TUPLE_ENUM(BOOST_PP_IIF(BOOST_PP_IS_BEGIN_PARENS(spec), \
+		(STRUCT_MODEL_INIT_SETTER_GETTER(classname, spec, attributes)), \
+		(STRUCT_MODEL_INIT_DATA_FIELD(classname, spec, attributes))))
+
+#define STRUCT_MODEL_INIT_FIELD_IMPL(classname, field) \
+	STRUCT_MODEL_INIT_FIELD_SPEC(classname, STRUCT_MODEL_SPEC(field), STRUCT_MODEL_ATTRIBUTES(field))
 
 #define STRUCT_MODEL_INIT_FIELD(z, i, fields) \
 	STRUCT_MODEL_INIT_FIELD_IMPL(STRUCT_MODEL_CLASSNAME(fields), STRUCT_MODEL_ELEMENT(i, fields))
@@ -468,18 +1285,72 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 #define STRUCT_MODEL_VISIT_FIELD(z, i, fields) \
 	STRUCT_MODEL_FIELDVAR_EX(i, fields).visit(v, std::forward<Pred>(pred));
 
-#define STRUCT_MODEL_FIND_FIELD(z, i, fields) \
-	if (strcmp(STRUCT_MODEL_FIELDVAR_EX(i, fields).name(), name)==0) {\
-		pred(STRUCT_MODEL_FIELDVAR_EX(i, fields)); \
-		return true; \
-	}
+#define STRUCT_MODEL_EACH_FIELD(z, i, fields) \
+	pred(STRUCT_MODEL_FIELDVAR_EX(i, fields));
 
+// Two field names with the same hash fail to compile as duplicate case values.
+#define STRUCT_MODEL_FIND_FIELD(z, i, fields) \
+	case name_hash(STRUCT_MODEL_ATTRIBUTES_EX(i, fields)::get().name): \
+		if (strcmp(STRUCT_MODEL_FIELDVAR_EX(i, fields).name(), name)==0) {\
+			pred(STRUCT_MODEL_FIELDVAR_EX(i, fields)); \
+			return true; \
+		} \
+		break;
+
+// Dense case labels, which compile to a jump table.
 #define STRUCT_MODEL_FIELD_INDEX(z, i, fields) \
-	else if (i==index) {\
+	case i: \
 		pred(STRUCT_MODEL_FIELDVAR_EX(i, fields)); \
-		return true; \
+		return true;
+
+// The own field at an index, resolved by overload at compile time.
+#define STRUCT_MODEL_OWN_FIELD(z, i, fields) \
+	const auto& own_field(std::integral_constant<size_t, i>) const noexcept { \
+		return STRUCT_MODEL_FIELDVAR_EX(i, fields); \
 	}
 
+#define STRUCT_MODEL_FIELD_KIND(field) \
+	kind_of<typename decltype(STRUCT_MODEL_FIELDVAR(field))::value_type>::value
+
+#define STRUCT_MODEL_DATA_DESCRIPTOR(field) \
+	make_descriptor(STRUCT_MODEL_ATTRIBUTES(field)::get(), offsetof(D, STRUCT_MODEL_FIELD_FIX(STRUCT_MODEL_UNBOX(field))), STRUCT_MODEL_FIELD_KIND(field))
+
+#define STRUCT_MODEL_ACCESSOR_DESCRIPTOR(field) \
+	make_descriptor(STRUCT_MODEL_ATTRIBUTES(field)::get(), field_descriptor::npos, STRUCT_MODEL_FIELD_KIND(field))
+
+#define STRUCT_MODEL_DESCRIPTOR(z, i, fields) \
+	BOOST_PP_COMMA_IF(i) BOOST_PP_IIF(BOOST_PP_IS_BEGIN_PARENS(STRUCT_MODEL_SPEC(BOOST_PP_TUPLE_ELEM(i, fields))), \
+		STRUCT_MODEL_ACCESSOR_DESCRIPTOR, STRUCT_MODEL_DATA_DESCRIPTOR)(BOOST_PP_TUPLE_ELEM(i, fields))
+
+#define STRUCT_MODEL_TUPLE_DESCRIPTOR(z, i, fields) \
+	BOOST_PP_COMMA_IF(i) STRUCT_MODEL_ACCESSOR_DESCRIPTOR(BOOST_PP_TUPLE_ELEM(i, fields))
+
+// offsetof on models that are not standard-layout, e.g. with fields in base classes,
+// is conditionally-supported; GCC and Clang support it for non-virtual bases.
+#if defined(__GNUC__)
+#define STRUCT_MODEL_OFFSETOF_BEGIN \
+	_Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Winvalid-offsetof\"")
+#define STRUCT_MODEL_OFFSETOF_END \
+	_Pragma("GCC diagnostic pop")
+#else
+#define STRUCT_MODEL_OFFSETOF_BEGIN
+#define STRUCT_MODEL_OFFSETOF_END
+#endif
+
+// The descriptors of the own fields of a model, with offsets in the derived type D.
+#define STRUCT_MODEL_OWN_DESCRIPTORS(descriptor, fields) \
+	STRUCT_MODEL_OFFSETOF_BEGIN \
+	template<typename D> \
+	static constexpr std::array<field_descriptor, BOOST_PP_TUPLE_SIZE(fields)> own_descriptors() noexcept { \
+		return std::array<field_descriptor, BOOST_PP_TUPLE_SIZE(fields)>{ { \
+			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(fields), descriptor, fields) \
+		} }; \
+	} \
+	STRUCT_MODEL_OFFSETOF_END
+
+#define STRUCT_MODEL_BASE_DESCRIPTORS(z, i, bases) \
+	inherited(STRUCT_INFO_BASE_CLASS(i, bases)::template descriptors<D>()),
+
 #define STRUCT_MODEL_FUNCTIONS(S) \
 	template<> struct is_reflected<S> : std::integral_constant<bool, true> { };
 
@@ -490,6 +1361,8 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 			typedef S struct_type; \
 			struct_info() = default; \
 			enum { field_count = BOOST_PP_TUPLE_SIZE((__VA_ARGS__)) };\
+			static constexpr size_t total_count = field_count; \
+			typedef std::tuple<> base_types; \
 			template<typename Document> \
 			void put(Document& doc, typename Document::element_type& element,  const S& v) const { \
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_PUT_FIELD, (__VA_ARGS__)) \
@@ -507,19 +1380,36 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_VISIT_FIELD, (__VA_ARGS__)) \
 			} \
 			template<typename Pred> \
-			bool find_field(const char* name, Pred&& pred) { \
+			void for_each_field(Pred&& pred) const { \
+				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_EACH_FIELD, (__VA_ARGS__)) \
+			} \
+			template<typename Pred> \
+			bool find_field(const char* name, Pred&& pred) const { \
+				return find_field(name, name_hash(name), std::forward<Pred>(pred)); \
+			} \
+			template<typename Pred> \
+			bool find_field(const char* name, std::uint64_t hash, Pred&& pred) const { \
+				switch (hash) { \
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_FIND_FIELD, (__VA_ARGS__)) \
-				return false; \
+				default: break; \
+				} \
+				return key_table<struct_info, false>::find(*this, name, hash, pred); \
 			} \
 			template<typename Pred> \
-			constexpr bool find_field(size_t index, Pred&& pred) { \
-				if (index>=field_count) return false; \
+			constexpr bool find_field(size_t index, Pred&& pred) const { \
+				switch (index) { \
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_FIELD_INDEX, (__VA_ARGS__)) \
-				return false; \
+				default: return false; \
+				} \
 			} \
-			static struct_info<S>& instance() noexcept { \
-				static struct_info<S> object; return object; \
+			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_OWN_FIELD, (__VA_ARGS__)) \
+			static const struct_info<S>& instance() noexcept { \
+				static const struct_info<S> object{ }; return object; \
 			} \
+			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_INIT_ATTRIBUTES, (__VA_ARGS__)) \
+			STRUCT_MODEL_OWN_DESCRIPTORS(STRUCT_MODEL_DESCRIPTOR, (__VA_ARGS__)) \
+			template<typename D> \
+			static constexpr auto descriptors() noexcept { return own_descriptors<D>(); } \
 			private: \
 			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_INIT_FIELD, (S, __VA_ARGS__)) \
         }; \
@@ -542,14 +1432,14 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 #define STRUCT_MODEL_INVOKE_FOR_EACH(z, i, bases) \
 	STRUCT_INFO_BASE_CLASS(i, bases)::for_each(v, std::forward<Pred>(pred));
 
-#define STRUCT_MODEL_INVOKE_VISIT(z, i, bases) \
-	if(STRUCT_INFO_BASE_CLASS(i, bases)::find_field(name, std::forward<Pred>(pred))) return true;
+#define STRUCT_MODEL_INVOKE_EACH_FIELD(z, i, bases) \
+	STRUCT_INFO_BASE_CLASS(i, bases)::for_each_field(std::forward<Pred>(pred));
+
+#define STRUCT_MODEL_BASE_COUNT(z, i, bases) \
+	STRUCT_INFO_BASE_CLASS(i, bases)::total_count +
 
-#define STRUCT_MODEL_FIND_INDEX(z, i, bases) \
-	if(index>=STRUCT_INFO_BASE_CLASS(i, bases)::field_count) \
-		index-=STRUCT_INFO_BASE_CLASS(i, bases)::field_count; \
-	else \
-		return STRUCT_INFO_BASE_CLASS(i, bases)::find_field(index, std::forward<Pred>(pred));
+#define STRUCT_MODEL_BASE_TYPE(z, i, bases) \
+	BOOST_PP_COMMA_IF(i) STRUCT_INFO_BASE_CLASS(i, bases)
 
 #define STRUCT_MODEL_INHERIT(S, bases, ...)  \
 	namespace leech { \
@@ -560,6 +1450,8 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 			typedef S struct_type; \
 			struct_info() = default; \
 			enum { field_count = BOOST_PP_TUPLE_SIZE((__VA_ARGS__)) };\
+			static constexpr size_t total_count = BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(bases), STRUCT_MODEL_BASE_COUNT, bases) field_count; \
+			typedef std::tuple<BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(bases), STRUCT_MODEL_BASE_TYPE, bases)> base_types; \
 			template<typename Document> \
 			void put(Document& doc, typename Document::element_type& element,  const S& v) const { \
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(bases), STRUCT_MODEL_INVOKE_PUT, bases) \
@@ -581,20 +1473,31 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_VISIT_FIELD, (__VA_ARGS__)) \
 			} \
 			template<typename Pred> \
-			bool find_field(const char* name, Pred&& pred) { \
-				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(bases), STRUCT_MODEL_INVOKE_VISIT, bases) \
-				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_FIND_FIELD, (__VA_ARGS__)) \
-				return false; \
+			void for_each_field(Pred&& pred) const { \
+				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(bases), STRUCT_MODEL_INVOKE_EACH_FIELD, bases) \
+				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_EACH_FIELD, (__VA_ARGS__)) \
 			} \
 			template<typename Pred> \
-			constexpr bool find_field(size_t index, Pred&& pred) { \
-				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(bases), STRUCT_MODEL_FIND_INDEX, bases) \
-				if (index>=field_count) return false; \
-				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_FIELD_INDEX, (__VA_ARGS__)) \
-				return false; \
+			bool find_field(const char* name, Pred&& pred) const { \
+				return find_field(name, name_hash(name), std::forward<Pred>(pred)); \
 			} \
-			static struct_info<S>& instance() noexcept { \
-				static struct_info<S> object; return object; \
+			template<typename Pred> \
+			bool find_field(const char* name, std::uint64_t hash, Pred&& pred) const { \
+				return key_table<struct_info<S>, true>::find(*this, name, hash, pred); \
+			} \
+			template<typename Pred> \
+			bool find_field(size_t index, Pred&& pred) const { \
+				return field_dispatch<struct_info<S>, std::remove_reference_t<Pred>>::find(*this, index, pred); \
+			} \
+			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_OWN_FIELD, (__VA_ARGS__)) \
+			static const struct_info<S>& instance() noexcept { \
+				static const struct_info<S> object{ }; return object; \
+			} \
+			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_INIT_ATTRIBUTES, (__VA_ARGS__)) \
+			STRUCT_MODEL_OWN_DESCRIPTORS(STRUCT_MODEL_DESCRIPTOR, (__VA_ARGS__)) \
+			template<typename D> \
+			static constexpr auto descriptors() noexcept { \
+				return join_descriptors(BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE(bases), STRUCT_MODEL_BASE_DESCRIPTORS, bases) own_descriptors<D>()); \
 			} \
 			private: \
 			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_INIT_FIELD, (S, __VA_ARGS__)) \
@@ -610,7 +1513,7 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 	std::tuple<BOOST_PP_ENUM(BOOST_PP_TUPLE_SIZE(t), STRUCT_MODEL_TUPLE_ELEMENT, t)>
 
 #define STRUCT_MODEL_TUPLE_INIT_FIELD_IMPL(i, field) \
-	struct_tuple_field<struct_type, i> STRUCT_MODEL_FIELDVAR(field) \
+	struct_tuple_field<struct_type, i, STRUCT_MODEL_ATTRIBUTES(field)> STRUCT_MODEL_FIELDVAR(field) \
 	{ STRUCT_MODEL_FIELD_NAME(field) };
 
 #define STRUCT_MODEL_TUPLE_INIT_TUPLE_FIELD(z, i, fields) \
@@ -623,6 +1526,8 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 			typedef STRUCT_MODEL_TUPLE_DEFINE((__VA_ARGS__)) struct_type;\
 			struct_info() = default; \
 			enum { field_count = BOOST_PP_TUPLE_SIZE((__VA_ARGS__)) };\
+			static constexpr size_t total_count = field_count; \
+			typedef std::tuple<> base_types; \
 			template<typename Document> \
 			void put(Document& doc, typename Document::element_type& element,  const struct_type& v) const { \
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_PUT_FIELD, (__VA_ARGS__)) \
@@ -640,19 +1545,36 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_VISIT_FIELD, (__VA_ARGS__)) \
 			} \
 			template<typename Pred> \
-			bool find_field(const char* name, Pred&& pred) { \
+			void for_each_field(Pred&& pred) const { \
+				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_EACH_FIELD, (__VA_ARGS__)) \
+			} \
+			template<typename Pred> \
+			bool find_field(const char* name, Pred&& pred) const { \
+				return find_field(name, name_hash(name), std::forward<Pred>(pred)); \
+			} \
+			template<typename Pred> \
+			bool find_field(const char* name, std::uint64_t hash, Pred&& pred) const { \
+				switch (hash) { \
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_FIND_FIELD, (__VA_ARGS__)) \
-				return false; \
+				default: break; \
+				} \
+				return key_table<struct_info, false>::find(*this, name, hash, pred); \
 			} \
 			template<typename Pred> \
-			constexpr bool find_field(size_t index, Pred&& pred) { \
-				if (index>=field_count) return false; \
+			constexpr bool find_field(size_t index, Pred&& pred) const { \
+				switch (index) { \
 				BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_FIELD_INDEX, (__VA_ARGS__)) \
-				return false; \
+				default: return false; \
+				} \
 			} \
-			static struct_info<struct_type>& instance() noexcept { \
-				static struct_info<struct_type> object; return object; \
+			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_OWN_FIELD, (__VA_ARGS__)) \
+			static const struct_info<struct_type>& instance() noexcept { \
+				static const struct_info<struct_type> object{ }; return object; \
 			} \
+			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_INIT_ATTRIBUTES, (__VA_ARGS__)) \
+			STRUCT_MODEL_OWN_DESCRIPTORS(STRUCT_MODEL_TUPLE_DESCRIPTOR, (__VA_ARGS__)) \
+			template<typename D> \
+			static constexpr auto descriptors() noexcept { return own_descriptors<D>(); } \
 			private: \
 			BOOST_PP_REPEAT(BOOST_PP_TUPLE_SIZE((__VA_ARGS__)), STRUCT_MODEL_TUPLE_INIT_TUPLE_FIELD, (__VA_ARGS__)) \
 		}; \
@@ -661,8 +1583,9 @@ inline void struct_field<T, Getter, Setter>::visit(T&& v, Pred&& pred) const
 }
 
 
+// Removed: whether a field is optional is a constant of the model, e.g. STRUCT_MODEL(S, ((field), optional)).
 #define STRUCT_MODEL_SET_OPTIONAL_VALUE(S, field, value) \
-	leech::detail::struct_info<S>::instance().find_field(#field, [](auto& field_info) { field_info.optional(value); })
+	static_assert(sizeof(S) == 0, "declare the field as ((" #field "), optional) in the model of " #S)
 
 #define STRUCT_MODEL_SET_OPTIONAL(S, field) \
 	STRUCT_MODEL_SET_OPTIONAL_VALUE(S, field, true);
@@ -0,0 +1,74 @@
+#ifndef _LEECH_PARALLEL_HPP_
+#define _LEECH_PARALLEL_HPP_
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+#include <system_error>
+#include <algorithm>
+
+namespace leech
+{
+
+	// Calls fn(first, last) over chunks of [0, count) on up to threads threads,
+	// the calling thread included; 0 uses every hardware thread. Threads take the
+	// next chunk as they finish one, so uneven items still balance. The first
+	// exception stops the remaining chunks and is rethrown once all threads have joined.
+	template<typename Fn>
+	inline void parallel_for(size_t count, size_t threads, Fn&& fn)
+	{
+		if (threads == 0)
+			threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		threads = std::min(threads, std::max<size_t>(count, 1));
+		size_t chunk = std::max<size_t>(count / (threads * 16), 1);
+
+		std::atomic<size_t> next(0);
+		std::atomic<bool> failed(false);
+		std::exception_ptr error;
+		std::mutex error_mutex;
+		auto work = [&]() {
+			try
+			{
+				for (;;)
+				{
+					size_t first = next.fetch_add(chunk);
+					if (first >= count || failed.load(std::memory_order_relaxed))
+						break;
+					fn(first, std::min(first + chunk, count));
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) error = std::current_exception();
+				failed = true;
+			}
+		};
+
+		std::vector<std::thread> workers;
+		workers.reserve(threads - 1);
+		for (size_t i = 1; i < threads; i++)
+		{
+			try
+			{
+				workers.emplace_back(work);
+			}
+			catch (const std::system_error&)
+			{
+				break;
+			}
+		}
+		work();
+		for (auto& worker : workers)
+			worker.join();
+		if (error)
+			std::rethrow_exception(error);
+	}
+
+}
+
+#endif //_LEECH_PARALLEL_HPP_
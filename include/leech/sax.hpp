@@ -0,0 +1,686 @@
+#ifndef _LEECH_SAX_HPP_
+#define _LEECH_SAX_HPP_
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <stdexcept>
+#include <type_traits>
+#include "model.hpp"
+
+namespace leech
+{
+
+namespace sax
+{
+
+	class error : public std::runtime_error
+	{
+	public:
+		explicit error(const std::string& text) : std::runtime_error(text) { }
+	};
+
+	struct frame;
+
+	// Where the next value goes: a target object and the operations of its type.
+	// A slot that decodes into a temporary carries a commit callback, which stores
+	// the temporary (apply is true) or only releases it (apply is false).
+	struct slot
+	{
+		void* target;
+		const struct ops* type;
+		void (*commit)(void* context, bool apply);
+		void* context;
+	};
+
+	// Event operations of one decoded type, nullptr for events the type does not accept.
+	struct ops
+	{
+		const char* name;
+		// Numbers given as text must be integer literals, as for integral C++ types.
+		bool integral;
+		void (*null_value)(void* target);
+		void (*boolean)(void* target, bool v);
+		void (*integer)(void* target, long long v);
+		void (*unsigned_integer)(void* target, unsigned long long v);
+		void (*floating)(void* target, double v);
+		void (*string)(void* target, const std::string& v);
+		void (*start_object)(frame& f);
+		bool (*key)(frame& f, const std::string& name, slot& next);
+		void (*end_object)(frame& f);
+		void (*start_array)(frame& f);
+		void (*element)(frame& f, slot& next);
+	};
+
+	// Releases the temporary of a slot that was taken but not completed.
+	struct slot_release
+	{
+		void operator()(slot* s) const noexcept
+		{
+			if (s->commit) s->commit(s->context, false);
+		}
+	};
+	typedef std::unique_ptr<slot, slot_release> slot_guard;
+
+	// The fields of an object found so far, one bit per index in field_table.
+	class field_set
+	{
+	public:
+		field_set() noexcept : _low(0) { }
+
+		void set(size_t index)
+		{
+			if (index < 64)
+			{
+				_low |= std::uint64_t(1) << index;
+				return;
+			}
+			index -= 64;
+			if (_high.size() <= index / 64)
+				_high.resize(index / 64 + 1);
+			_high[index / 64] |= std::uint64_t(1) << (index % 64);
+		}
+		bool test(size_t index) const noexcept
+		{
+			if (index < 64)
+				return (_low >> index) & 1;
+			index -= 64;
+			return index / 64 < _high.size() && ((_high[index / 64] >> (index % 64)) & 1);
+		}
+
+	private:
+		std::uint64_t _low;
+		std::vector<std::uint64_t> _high;
+	};
+
+	struct frame
+	{
+		slot target;
+		bool array;
+		size_t count;
+		field_set fields;
+	};
+
+	template<typename T, typename = void>
+	struct value_ops;
+
+	template<typename T>
+	constexpr ops ops_of = value_ops<T>::make();
+
+	template<typename T>
+	inline slot make_slot(T& v) noexcept
+	{
+		return slot{ &v, &ops_of<T>, nullptr, nullptr };
+	}
+
+	template<>
+	struct value_ops<bool>
+	{
+		static void boolean(void* target, bool v)
+		{
+			*static_cast<bool*>(target) = v;
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "boolean";
+			result.boolean = &boolean;
+			return result;
+		}
+	};
+
+	template<typename T>
+	struct value_ops<T, typename std::enable_if<std::is_arithmetic<T>::value && !std::is_same<T, bool>::value>::type>
+	{
+		static void integer(void* target, long long v)
+		{
+			*static_cast<T*>(target) = static_cast<T>(v);
+		}
+		static void unsigned_integer(void* target, unsigned long long v)
+		{
+			*static_cast<T*>(target) = static_cast<T>(v);
+		}
+		static void floating(void* target, double v)
+		{
+			*static_cast<T*>(target) = static_cast<T>(v);
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "number";
+			result.integral = std::is_integral<T>::value;
+			result.integer = &integer;
+			result.unsigned_integer = &unsigned_integer;
+			result.floating = &floating;
+			return result;
+		}
+	};
+
+	template<typename T>
+	struct value_ops<T, typename std::enable_if<std::is_enum<T>::value>::type>
+	{
+		static void integer(void* target, long long v)
+		{
+			*static_cast<T*>(target) = static_cast<T>(v);
+		}
+		static void unsigned_integer(void* target, unsigned long long v)
+		{
+			*static_cast<T*>(target) = static_cast<T>(v);
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "number";
+			result.integer = &integer;
+			result.unsigned_integer = &unsigned_integer;
+			return result;
+		}
+	};
+
+	template<typename Traits, typename Allocator>
+	struct value_ops<std::basic_string<char, Traits, Allocator>>
+	{
+		typedef std::basic_string<char, Traits, Allocator> string_type;
+		static void string(void* target, const std::string& v)
+		{
+			static_cast<string_type*>(target)->assign(v.data(), v.size());
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "string";
+			result.string = &string;
+			return result;
+		}
+	};
+
+	template<typename Sequence>
+	struct sequence_ops
+	{
+		static void start_array(frame& f)
+		{
+			static_cast<Sequence*>(f.target.target)->clear();
+		}
+		static void element(frame& f, slot& next)
+		{
+			Sequence& v = *static_cast<Sequence*>(f.target.target);
+			v.emplace_back();
+			next = make_slot(v.back());
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "array";
+			result.start_array = &start_array;
+			result.element = &element;
+			return result;
+		}
+	};
+
+	template<typename T, typename Allocator>
+	struct value_ops<std::vector<T, Allocator>> : public sequence_ops<std::vector<T, Allocator>> { };
+
+	template<typename T, typename Allocator>
+	struct value_ops<std::list<T, Allocator>> : public sequence_ops<std::list<T, Allocator>> { };
+
+	// The bit that element appended to a std::vector<bool>, decoded as a bool. The slot
+	// targets the vector itself, since a bit has no address.
+	template<typename Vector>
+	struct last_bit { };
+
+	template<typename Vector>
+	struct value_ops<last_bit<Vector>>
+	{
+		static void boolean(void* target, bool v)
+		{
+			static_cast<Vector*>(target)->back() = v;
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "boolean";
+			result.boolean = &boolean;
+			return result;
+		}
+	};
+
+	template<typename Allocator>
+	struct value_ops<std::vector<bool, Allocator>>
+	{
+		typedef std::vector<bool, Allocator> vector_type;
+		static void start_array(frame& f)
+		{
+			static_cast<vector_type*>(f.target.target)->clear();
+		}
+		static void element(frame& f, slot& next)
+		{
+			vector_type& v = *static_cast<vector_type*>(f.target.target);
+			v.push_back(false);
+			next = slot{ &v, &ops_of<last_bit<vector_type>>, nullptr, nullptr };
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "array";
+			result.start_array = &start_array;
+			result.element = &element;
+			return result;
+		}
+	};
+
+	template<typename Map>
+	struct map_ops
+	{
+		static void start_object(frame& f)
+		{
+			static_cast<Map*>(f.target.target)->clear();
+		}
+		static bool key(frame& f, const std::string& name, slot& next)
+		{
+			Map& v = *static_cast<Map*>(f.target.target);
+			next = make_slot(entry(v, name, std::is_same<typename Map::key_type, std::string>()));
+			return true;
+		}
+		static typename Map::mapped_type& entry(Map& v, const std::string& name, std::true_type)
+		{
+			return v[name];
+		}
+		// Keys with another allocator, such as std::pmr::string, are built with the one of the map.
+		static typename Map::mapped_type& entry(Map& v, const std::string& name, std::false_type)
+		{
+			return v[typename Map::key_type(name.data(), name.size(), v.get_allocator())];
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "object";
+			result.start_object = &start_object;
+			result.key = &key;
+			return result;
+		}
+	};
+
+	template<typename Traits, typename KeyAllocator, typename T, typename Compare, typename Allocator>
+	struct value_ops<std::map<std::basic_string<char, Traits, KeyAllocator>, T, Compare, Allocator>>
+		: public map_ops<std::map<std::basic_string<char, Traits, KeyAllocator>, T, Compare, Allocator>> { };
+
+	template<typename Traits, typename KeyAllocator, typename T, typename Hash, typename Equal, typename Allocator>
+	struct value_ops<std::unordered_map<std::basic_string<char, Traits, KeyAllocator>, T, Hash, Equal, Allocator>>
+		: public map_ops<std::unordered_map<std::basic_string<char, Traits, KeyAllocator>, T, Hash, Equal, Allocator>> { };
+
+	// A field read through a setter is decoded into a temporary and stored when it completes.
+	template<typename S, typename Field>
+	struct deferred_field
+	{
+		S* object;
+		Field* field;
+		typename Field::value_type value;
+
+		static void commit(void* context, bool apply)
+		{
+			std::unique_ptr<deferred_field> self(static_cast<deferred_field*>(context));
+			if (apply) self->field->set_value(*self->object, std::move(self->value));
+		}
+	};
+
+	template<typename S, typename Field>
+	inline slot field_slot(S& v, Field& field, std::true_type)
+	{
+		auto& value = field.get_value(v);
+		detail::bind_resource(value);
+		return make_slot(value);
+	}
+
+	template<typename S, typename Field>
+	inline slot field_slot(S& v, Field& field, std::false_type)
+	{
+		std::unique_ptr<deferred_field<S, Field>> context(new deferred_field<S, Field>{ &v, &field, typename Field::value_type() });
+		detail::bind_resource(context->value);
+		slot result{ &context->value, &ops_of<typename Field::value_type>, &deferred_field<S, Field>::commit, context.get() };
+		context.release();
+		return result;
+	}
+
+	template<typename S>
+	struct value_ops<S, typename std::enable_if<is_reflected<S>::value>::type>
+	{
+		static void start_object(frame& f)
+		{
+			// Fields with a default value get it first, in case their key is missing.
+			S& v = *static_cast<S*>(f.target.target);
+			for_each_field<S>([&v](const auto& field) { field.set_default(v); });
+		}
+		static bool key(frame& f, const std::string& name, slot& next)
+		{
+			S& v = *static_cast<S*>(f.target.target);
+			return find_field<S>(name.data(), [&](auto& field) {
+				typedef std::decay_t<decltype(field)> field_type;
+				next = field_slot(v, field, typename field_type::in_place());
+				if (!field.optional()) f.fields.set(detail::field_index<S, field_type>());
+			});
+		}
+		// A key given twice still leaves a missing one unset.
+		static void end_object(frame& f)
+		{
+			size_t index = 0;
+			for_each_field<S>([&](const auto& field) {
+				if (!field.optional() && !f.fields.test(index))
+					throw error(std::string("missing required field \"") + field.name() + "\"");
+				++index;
+			});
+		}
+		static constexpr ops make()
+		{
+			ops result{ };
+			result.name = "object";
+			result.start_object = &start_object;
+			result.key = &key;
+			result.end_object = &end_object;
+			return result;
+		}
+	};
+
+	// Decodes a stream of parser events into an object, without building a document tree.
+	// Keys are matched to reflected fields as they arrive; unknown keys are skipped.
+	class decoder
+	{
+	public:
+		template<typename T>
+		explicit decoder(T& v) : _root(), _pending(), _skip(0), _done(false) { reset(v); }
+		decoder(const decoder&) = delete;
+		decoder& operator=(const decoder&) = delete;
+		~decoder() { release(); }
+
+		template<typename T>
+		void reset(T& v)
+		{
+			release();
+			_root = make_slot(v);
+			_pending = slot{ };
+			_skip = 0;
+			_done = false;
+		}
+
+		bool done() const noexcept { return _done; }
+
+		void null_value()
+		{
+			slot next;
+			if (!begin(next)) return;
+			slot_guard guard(&next);
+			if (!next.type->null_value) mismatch(next, "null");
+			next.type->null_value(next.target);
+			complete(guard);
+		}
+		void boolean(bool v)
+		{
+			slot next;
+			if (!begin(next)) return;
+			slot_guard guard(&next);
+			if (!next.type->boolean) mismatch(next, "boolean");
+			next.type->boolean(next.target, v);
+			complete(guard);
+		}
+		void integer(long long v)
+		{
+			slot next;
+			if (!begin(next)) return;
+			slot_guard guard(&next);
+			if (!next.type->integer) mismatch(next, "number");
+			next.type->integer(next.target, v);
+			complete(guard);
+		}
+		void unsigned_integer(unsigned long long v)
+		{
+			slot next;
+			if (!begin(next)) return;
+			slot_guard guard(&next);
+			if (!next.type->unsigned_integer) mismatch(next, "number");
+			next.type->unsigned_integer(next.target, v);
+			complete(guard);
+		}
+		void floating(double v)
+		{
+			slot next;
+			if (!begin(next)) return;
+			slot_guard guard(&next);
+			if (!next.type->floating) mismatch(next, "number");
+			next.type->floating(next.target, v);
+			complete(guard);
+		}
+		void string(const std::string& v)
+		{
+			slot next;
+			if (!begin(next)) return;
+			slot_guard guard(&next);
+			if (!next.type->string) mismatch(next, "string");
+			next.type->string(next.target, v);
+			complete(guard);
+		}
+
+		// A scalar given as untyped text, as YAML reports them: it is converted to what
+		// the target accepts, a string as it is, else a boolean or a number.
+		void scalar(const std::string& v)
+		{
+			slot next;
+			if (!begin(next)) return;
+			slot_guard guard(&next);
+			if (next.type->string)
+				next.type->string(next.target, v);
+			else if (next.type->boolean)
+				next.type->boolean(next.target, text_boolean(v));
+			else if (next.type->integer || next.type->floating)
+				text_number(next, v);
+			else
+				mismatch(next, "scalar");
+			complete(guard);
+		}
+
+		void start_object()
+		{
+			if (_skip)
+			{
+				++_skip;
+				return;
+			}
+			slot next;
+			begin(next);
+			slot_guard guard(&next);
+			if (!next.type->key) mismatch(next, "object");
+			_frames.push_back(frame{ next, false, 0, field_set() });
+			guard.release();
+			if (next.type->start_object)
+				next.type->start_object(_frames.back());
+		}
+		void key(const std::string& name)
+		{
+			if (_skip) return;
+			frame& top = _frames.back();
+			if (!top.target.type->key(top, name, _pending))
+			{
+				_pending = slot{ };
+				_skip = 1;
+			}
+		}
+		void end_object()
+		{
+			if (!end()) return;
+			frame& top = _frames.back();
+			if (top.target.type->end_object)
+				top.target.type->end_object(top);
+			slot target = top.target;
+			_frames.pop_back();
+			complete(target);
+		}
+
+		void start_array()
+		{
+			if (_skip)
+			{
+				++_skip;
+				return;
+			}
+			slot next;
+			begin(next);
+			slot_guard guard(&next);
+			if (!next.type->element) mismatch(next, "array");
+			_frames.push_back(frame{ next, true, 0, field_set() });
+			guard.release();
+			if (next.type->start_array)
+				next.type->start_array(_frames.back());
+		}
+		void end_array()
+		{
+			if (!end()) return;
+			slot target = _frames.back().target;
+			_frames.pop_back();
+			complete(target);
+		}
+
+	private:
+		slot _root;
+		slot _pending;
+		std::vector<frame> _frames;
+		size_t _skip;
+		bool _done;
+
+		// Takes the slot of the value that starts now; false if the value is skipped.
+		bool begin(slot& next)
+		{
+			if (_skip)
+			{
+				if (_skip == 1) _skip = 0;
+				return false;
+			}
+			if (_frames.empty())
+			{
+				if (_done) throw error("unexpected value after the end of the document");
+				next = _root;
+			}
+			else if (_frames.back().array)
+			{
+				frame& top = _frames.back();
+				top.target.type->element(top, next);
+				++top.count;
+			}
+			else
+			{
+				next = _pending;
+				_pending = slot{ };
+			}
+			return true;
+		}
+		bool end()
+		{
+			if (_skip)
+			{
+				if (--_skip == 1) _skip = 0;
+				return false;
+			}
+			return true;
+		}
+		void complete(slot_guard& guard)
+		{
+			complete(*guard.release());
+		}
+		void complete(const slot& target)
+		{
+			if (target.commit) target.commit(target.context, true);
+			if (_frames.empty()) _done = true;
+		}
+		static bool text_boolean(const std::string& v)
+		{
+			static const char* const words[] = { "y", "Y", "yes", "Yes", "YES", "true", "True", "TRUE", "on", "On", "ON",
+				"n", "N", "no", "No", "NO", "false", "False", "FALSE", "off", "Off", "OFF" };
+			for (size_t i = 0; i != sizeof(words) / sizeof(words[0]); i++)
+			{
+				if (v == words[i])
+					return i < 11;
+			}
+			throw error("invalid boolean \"" + v + "\"");
+		}
+		// Integers may be hexadecimal (0x) or octal (0o) and integral targets take nothing
+		// else, like 1.5; floating point numbers may be .inf or .nan, either signed.
+		static void text_number(const slot& next, const std::string& v)
+		{
+			const char* first = v.c_str();
+			if (*first == 0 || ((*first == '-' || *first == '+') && first[1] == 0))
+				throw error("invalid number \"" + v + "\"");
+			bool negative = *first == '-';
+			const char* digits = first + (negative || *first == '+' ? 1 : 0);
+			int base = 10;
+			if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'o'))
+			{
+				base = digits[1] == 'x' ? 16 : 8;
+				digits += 2;
+			}
+			char* last;
+			if (next.type->integer && isxdigit(static_cast<unsigned char>(*digits)))
+			{
+				errno = 0;
+				unsigned long long n = strtoull(digits, &last, base);
+				if (*last == 0 && errno == 0)
+				{
+					if (!negative && n > static_cast<unsigned long long>(LLONG_MAX) && next.type->unsigned_integer)
+						next.type->unsigned_integer(next.target, n);
+					else if (n <= static_cast<unsigned long long>(LLONG_MAX) + (negative ? 1 : 0))
+						next.type->integer(next.target, negative ? static_cast<long long>(0 - n) : static_cast<long long>(n));
+					else
+						throw error("number out of range \"" + v + "\"");
+					return;
+				}
+			}
+			if (next.type->integral)
+				throw error("invalid integer \"" + v + "\"");
+			if (next.type->floating && base == 10)
+			{
+				double d;
+				if (strcmp(digits, ".inf") == 0 || strcmp(digits, ".Inf") == 0 || strcmp(digits, ".INF") == 0)
+					d = negative ? -HUGE_VAL : HUGE_VAL;
+				else if (strcmp(digits, ".nan") == 0 || strcmp(digits, ".NaN") == 0 || strcmp(digits, ".NAN") == 0)
+					d = negative ? -NAN : NAN;
+				else if (isdigit(static_cast<unsigned char>(*digits)) || *digits == '.')
+				{
+					d = strtod(first, &last);
+					if (*last)
+						throw error("invalid number \"" + v + "\"");
+				}
+				else
+					throw error("invalid number \"" + v + "\"");
+				next.type->floating(next.target, d);
+				return;
+			}
+			throw error("invalid number \"" + v + "\"");
+		}
+		[[noreturn]] void mismatch(const slot& next, const char* found)
+		{
+			throw error(std::string("type mismatch, expected ") + next.type->name + " but found " + found);
+		}
+		void release() noexcept
+		{
+			if (_pending.commit) _pending.commit(_pending.context, false);
+			_pending = slot{ };
+			for (auto it = _frames.rbegin(); it != _frames.rend(); ++it)
+			{
+				if (it->target.commit) it->target.commit(it->target.context, false);
+			}
+			_frames.clear();
+		}
+	};
+
+}
+
+}
+
+#endif //_LEECH_SAX_HPP_
@@ -6,6 +6,18 @@
 #include <toml.hpp>
 #include <sstream>
 #include <fstream>
+#include <deque>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include "model.hpp"
+#include "mapped_file.hpp"
 
 namespace leech
 {
@@ -54,6 +66,18 @@ namespace leech
 			{
 				return element[name];
 			}
+			bool has_child(const element_type& element, const char* name) const
+			{
+				return element.is_table() && element.as_table().count(name) != 0;
+			}
+			// Calls fn(name, child) for each key of a table, in the order the table stores them.
+			template<typename Fn>
+			void for_each_child(const element_type& element, Fn&& fn) const
+			{
+				if (!element.is_table()) return;
+				for (const auto& item : element.as_table())
+					fn(item.first.c_str(), item.second);
+			}
 
 			template<typename T>
 			void put(element_type& element, const T& v) const
@@ -83,33 +107,475 @@ namespace leech
 		{
 			return document(::toml::parse(input));
 		}
-		inline document load_file(const char* filename)
+		inline document load_file(const char* filename, load_stats* stats = nullptr)
 		{
-			std::ifstream fs(filename);
-			return document(::toml::parse(fs));
+			load_timer timer(stats);
+			mapped_file file;
+			if (!file.open(filename))
+			{
+				std::ifstream fs(filename);
+				return document(::toml::parse(fs));
+			}
+			timer.io_done();
+			memory_istream is(file);
+			document doc(::toml::parse(is, filename));
+			timer.parse_done();
+			return doc;
 		}
 
+		// Values written as tables: reflected structs and maps with string keys.
+		template<typename T>
+		struct is_table : public is_reflected<T> { };
+
+		template<typename T>
+		struct is_table<std::map<std::string, T>> : public std::true_type { };
+
+		template<typename T>
+		struct is_table<std::unordered_map<std::string, T>> : public std::true_type { };
+
+		// Writes TOML text in one pass, without building ::toml::value trees. Each table keeps
+		// its key/value lines apart from its sub-tables, which TOML wants after them, and
+		// joins both under its [table] header when it is closed. Sequences of tables are
+		// written as [[array-of-tables]], other sequences as inline arrays.
+		class writer
+		{
+		public:
+			struct frame
+			{
+				enum state_type { empty, table, closed };
+
+				explicit frame(size_t d) noexcept : depth(d), state(empty), element(false) { }
+
+				size_t depth;
+				state_type state;
+				// An element of an array of tables.
+				bool element;
+				std::string key;
+				std::string path;
+				std::string body;
+				std::string tables;
+			};
+			typedef frame element_type;
+
+			writer() : _os(nullptr), _depth(0)
+			{
+				_frames.emplace_back(0);
+			}
+			explicit writer(std::ostream& os) : _os(&os), _depth(0)
+			{
+				_frames.emplace_back(0);
+			}
+			writer(const writer&) = delete;
+			writer& operator=(const writer&) = delete;
+
+			element_type& root() noexcept { return _frames.front(); }
+
+			// Completes the pending document and returns the buffered text.
+			const std::string& str()
+			{
+				finish();
+				return _buffer;
+			}
+			// Completes the pending document and writes the buffered text to the stream.
+			void flush()
+			{
+				finish();
+				if (_os && !_buffer.empty())
+				{
+					_os->write(_buffer.data(), _buffer.size());
+					_buffer.clear();
+				}
+			}
+			// Drops the buffered text, keeps its capacity for the next document.
+			void clear() noexcept
+			{
+				_buffer.clear();
+				_depth = 0;
+				frame& f = _frames.front();
+				f.state = frame::empty;
+				f.body.clear();
+				f.tables.clear();
+			}
+
+			element_type& child(element_type& element, const char* name)
+			{
+				unwind(element.depth);
+				open_table(element);
+				frame& result = enter(element);
+				write_key(result.key, name, strlen(name));
+				return result;
+			}
+
+			template<typename T>
+			void put(element_type& element, const T& v)
+			{
+				std::string& out = assignment(element);
+				write_value(out, v);
+				out += '\n';
+				element.state = frame::closed;
+			}
+			template<typename T>
+			void put(element_type& element, const std::vector<T>& v)
+			{
+				put_array(element, v, is_table<T>());
+			}
+			template<typename T>
+			void put(element_type& element, const std::list<T>& v)
+			{
+				put_array(element, v, is_table<T>());
+			}
+			template<typename T>
+			void put(element_type& element, const std::map<std::string, T>& v)
+			{
+				put_table(element, v);
+			}
+			template<typename T>
+			void put(element_type& element, const std::unordered_map<std::string, T>& v)
+			{
+				put_table(element, v);
+			}
+
+		private:
+			std::deque<frame> _frames;
+			std::string _buffer;
+			std::ostream* _os;
+			size_t _depth;
+
+			element_type& enter(const element_type& parent)
+			{
+				size_t depth = parent.depth + 1;
+				if (_frames.size() <= depth)
+					_frames.emplace_back(depth);
+				frame& result = _frames[depth];
+				result.state = frame::empty;
+				result.element = false;
+				result.key.clear();
+				_depth = depth;
+				return result;
+			}
+			void unwind(size_t depth)
+			{
+				for (; _depth > depth; --_depth)
+					close(_frames[_depth]);
+			}
+			void close(frame& f)
+			{
+				if (f.state == frame::closed)
+					return;
+				frame& parent = _frames[f.depth - 1];
+				if (f.element)
+				{
+					parent.tables += "[[";
+					parent.tables += f.path;
+					parent.tables += "]]\n";
+					parent.tables += f.body;
+					parent.tables += f.tables;
+				}
+				else if (f.state == frame::empty)
+				{
+					parent.body += f.key;
+					parent.body += " = {}\n";
+				}
+				else
+				{
+					parent.tables += '[';
+					parent.tables += f.path;
+					parent.tables += "]\n";
+					parent.tables += f.body;
+					parent.tables += f.tables;
+				}
+				f.body.clear();
+				f.tables.clear();
+				f.state = frame::closed;
+			}
+			void finish()
+			{
+				unwind(0);
+				frame& f = _frames.front();
+				if (f.state == frame::closed)
+					return;
+				_buffer += f.body;
+				_buffer += f.tables;
+				f.body.clear();
+				f.tables.clear();
+				f.state = frame::closed;
+			}
+
+			// Turns an element into a table; its dotted path names it in the headers.
+			void open_table(frame& f)
+			{
+				if (f.state == frame::table)
+					return;
+				f.state = frame::table;
+				if (f.depth == 0 || f.element)
+					return;
+				const frame& parent = _frames[f.depth - 1];
+				f.path = parent.path;
+				if (!f.path.empty())
+					f.path += '.';
+				f.path += f.key;
+			}
+			// Starts a "key = " line in the enclosing table and returns its text.
+			std::string& assignment(frame& f)
+			{
+				unwind(f.depth);
+				if (f.depth == 0)
+					throw std::invalid_argument("the top of a TOML document must be a table");
+				std::string& out = _frames[f.depth - 1].body;
+				out += f.key;
+				out += " = ";
+				return out;
+			}
+
+			template<typename Range>
+			void put_array(element_type& element, const Range& v, std::false_type)
+			{
+				std::string& out = assignment(element);
+				write_inline(out, v);
+				out += '\n';
+				element.state = frame::closed;
+			}
+			template<typename Range>
+			void put_array(element_type& element, const Range& v, std::true_type)
+			{
+				if (v.empty())
+				{
+					put_array(element, v, std::false_type());
+					return;
+				}
+				unwind(element.depth);
+				if (element.depth == 0)
+					throw std::invalid_argument("the top of a TOML document must be a table");
+				open_table(element);
+				for (const auto& item : v)
+				{
+					frame& f = enter(element);
+					f.element = true;
+					f.path = element.path;
+					f.state = frame::table;
+					leech::put(*this, f, item);
+					unwind(element.depth);
+				}
+				_frames[element.depth - 1].tables += element.tables;
+				element.tables.clear();
+				element.body.clear();
+				element.state = frame::closed;
+			}
+			template<typename Map>
+			void put_table(element_type& element, const Map& v)
+			{
+				unwind(element.depth);
+				open_table(element);
+				for (const auto& item : v)
+				{
+					leech::put(*this, child(element, item.first.c_str()), item.second);
+				}
+				unwind(element.depth);
+			}
+
+			// Values inside inline arrays: nested arrays, and { key = value } for tables.
+			template<typename T>
+			typename std::enable_if<!is_reflected<T>::value>::type write_inline(std::string& out, const T& v)
+			{
+				write_value(out, v);
+			}
+			template<typename T>
+			typename std::enable_if<is_reflected<T>::value>::type write_inline(std::string& out, const T& v)
+			{
+				out += '{';
+				bool first = true;
+				for_each_field<T>([&](const auto& field) {
+					if (field.skip_write())
+						return;
+					out += first ? " " : ", ";
+					first = false;
+					const char* name = field.name();
+					write_key(out, name, strlen(name));
+					out += " = ";
+					write_inline(out, field.get_value(v));
+				});
+				out += first ? "}" : " }";
+			}
+			template<typename T>
+			void write_inline(std::string& out, const std::vector<T>& v)
+			{
+				write_inline_array(out, v);
+			}
+			template<typename T>
+			void write_inline(std::string& out, const std::list<T>& v)
+			{
+				write_inline_array(out, v);
+			}
+			template<typename T>
+			void write_inline(std::string& out, const std::map<std::string, T>& v)
+			{
+				write_inline_table(out, v);
+			}
+			template<typename T>
+			void write_inline(std::string& out, const std::unordered_map<std::string, T>& v)
+			{
+				write_inline_table(out, v);
+			}
+			template<typename Range>
+			void write_inline_array(std::string& out, const Range& v)
+			{
+				out += '[';
+				bool first = true;
+				for (const auto& item : v)
+				{
+					if (!first) out += ", ";
+					first = false;
+					write_inline(out, item);
+				}
+				out += ']';
+			}
+			template<typename Map>
+			void write_inline_table(std::string& out, const Map& v)
+			{
+				out += '{';
+				bool first = true;
+				for (const auto& item : v)
+				{
+					out += first ? " " : ", ";
+					first = false;
+					write_key(out, item.first.data(), item.first.size());
+					out += " = ";
+					write_inline(out, item.second);
+				}
+				out += first ? "}" : " }";
+			}
+
+			void write_value(std::string& out, bool v)
+			{
+				out += v ? "true" : "false";
+			}
+			void write_value(std::string& out, const char* v)
+			{
+				write_string(out, v, strlen(v));
+			}
+			void write_value(std::string& out, const std::string& v)
+			{
+				write_string(out, v.data(), v.size());
+			}
+			template<typename T>
+			typename std::enable_if<std::is_integral<T>::value>::type write_value(std::string& out, T v)
+			{
+				char text[24];
+				char* last = text + sizeof(text);
+				char* first = last;
+				typename std::make_unsigned<T>::type n = static_cast<typename std::make_unsigned<T>::type>(v);
+				if (v < 0) n = 0 - n;
+				do
+				{
+					*--first = static_cast<char>('0' + n % 10);
+					n /= 10;
+				} while (n);
+				if (v < 0) *--first = '-';
+				out.append(first, last);
+			}
+			template<typename T>
+			typename std::enable_if<std::is_floating_point<T>::value>::type write_value(std::string& out, T v)
+			{
+				double d = static_cast<double>(v);
+				if (std::isnan(d))
+				{
+					out += "nan";
+					return;
+				}
+				if (std::isinf(d))
+				{
+					out += d < 0 ? "-inf" : "inf";
+					return;
+				}
+				// 15 digits when they read back to the same double, else 17; TOML needs a '.' or an exponent.
+				char text[32];
+				int length = snprintf(text, sizeof(text), "%.15g", d);
+				if (strtod(text, nullptr) != d)
+					length = snprintf(text, sizeof(text), "%.17g", d);
+				out.append(text, length);
+				if (!strpbrk(text, ".e"))
+					out += ".0";
+			}
+			template<typename T>
+			typename std::enable_if<!std::is_arithmetic<T>::value>::type write_value(std::string& out, const T& v)
+			{
+				std::ostringstream oss;
+				oss << ::toml::value(v);
+				out += oss.str();
+			}
+
+			// A bare key when it only has letters, digits, '_' and '-', else a quoted one.
+			static void write_key(std::string& out, const char* name, size_t length)
+			{
+				bool bare = length != 0;
+				for (size_t i = 0; bare && i != length; i++)
+				{
+					char c = name[i];
+					bare = (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+				}
+				if (bare)
+					out.append(name, length);
+				else
+					write_string(out, name, length);
+			}
+			static void write_string(std::string& out, const char* text, size_t length)
+			{
+				static const char hex[] = "0123456789ABCDEF";
+				out += '"';
+				const char* first = text;
+				const char* last = text + length;
+				for (const char* p = first; p != last; ++p)
+				{
+					unsigned char c = static_cast<unsigned char>(*p);
+					if (c >= 0x20 && c != 0x7f && c != '"' && c != '\\')
+						continue;
+					out.append(first, p);
+					first = p + 1;
+					out += '\\';
+					switch (c)
+					{
+					case '"': out += '"'; break;
+					case '\\': out += '\\'; break;
+					case '\b': out += 'b'; break;
+					case '\f': out += 'f'; break;
+					case '\n': out += 'n'; break;
+					case '\r': out += 'r'; break;
+					case '\t': out += 't'; break;
+					default:
+						out += "u00";
+						out += hex[c >> 4];
+						out += hex[c & 0x0f];
+					}
+				}
+				out.append(first, last);
+				out += '"';
+			}
+		};
+
 	}
 }
 
-#define STRUCT_FROM_TOMML(S) \
+#define STRUCT_FROM_TOML(S) \
 namespace toml { \
 	template<> struct from<S> { \
 		template<typename C, template<typename ...> class M, template<typename ...> class A> \
-		static ext::foo from_toml(const basic_value<C, M, A>& v) { \
+		static S from_toml(const basic_value<C, M, A>& v) { \
 			S data; \
-			leech::get<S>(leech::tomml::document(v), data); \
+			leech::get(leech::toml::document(v), data); \
 			return data; \
 		} \
 	}; \
 }
 
+// The old misspelled name.
+#define STRUCT_FROM_TOMML(S) STRUCT_FROM_TOML(S)
+
 #define STRUCT_TO_TOML(S) \
 namespace toml { \
 	template<> struct into<S> { \
-		static toml::value into_toml(const S& data) { \
-			leech::toml::document doc; \
-			return leech::put<S>(doc, data); \
+		static ::toml::value into_toml(const S& data) { \
+			leech::toml::document doc{ ::toml::value(::toml::table()) }; \
+			leech::put(doc, data); \
 			return doc.root(); \
 		} \
 	}; \
@@ -0,0 +1,171 @@
+#ifndef _LEECH_TRACKED_HPP_
+#define _LEECH_TRACKED_HPP_
+
+#pragma once
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <type_traits>
+#include "model.hpp"
+
+namespace leech
+{
+
+	// Where a tracked value is written: a document, an element or a cache, kept by the
+	// caller next to it. Every target has an id that is never reused, so a new target
+	// gets every field even where an old one was. A copy is a new target.
+	class write_target
+	{
+	public:
+		write_target() noexcept : _id(next_id()) { }
+		write_target(const write_target&) noexcept : _id(next_id()) { }
+		write_target& operator=(const write_target&) noexcept
+		{
+			_id = next_id();
+			return *this;
+		}
+
+		std::uint64_t id() const noexcept { return _id; }
+		// Forgets what was written, e.g. after the document was cleared.
+		void reset() noexcept { _id = next_id(); }
+
+	private:
+		std::uint64_t _id;
+
+		static std::uint64_t next_id() noexcept
+		{
+			static std::atomic<std::uint64_t> counter(0);
+			return ++counter;
+		}
+	};
+
+	// A reflected value that remembers which of its fields changed, so put_dirty only
+	// writes those again into the target it wrote before. Changes must go through
+	// assign, edit or mark; a value that was never written, or is written to another
+	// target, is written whole.
+	template<typename T>
+	class tracked
+	{
+	public:
+		static_assert(is_reflected<T>::value, "tracked needs a reflected type");
+		typedef std::bitset<field_table<T>.size()> field_set;
+
+		tracked() : _value(), _target(0) { _dirty.set(); }
+		explicit tracked(const T& value) : _value(value), _target(0) { _dirty.set(); }
+		explicit tracked(T&& value) : _value(std::move(value)), _target(0) { _dirty.set(); }
+
+		const T& value() const noexcept { return _value; }
+		const T& operator*() const noexcept { return _value; }
+		const T* operator->() const noexcept { return &_value; }
+
+		// Sets a field by name and marks it, false if T has no such field.
+		template<typename V>
+		bool assign(const char* name, V&& v)
+		{
+			size_t index = detail::find_field_index<T>(name);
+			if (index == field_descriptor::npos)
+				return false;
+			leech::assign(_value, name, std::forward<V>(v));
+			_dirty.set(index);
+			return true;
+		}
+		// Gives write access to a data member, found by its offset in field_table, and marks it.
+		template<typename M, typename C>
+		M& edit(M C::* member)
+		{
+			static_assert(std::is_base_of<C, T>::value, "not a member of the tracked type");
+			M& field = _value.*member;
+			size_t offset = static_cast<size_t>(reinterpret_cast<const char*>(&field) - reinterpret_cast<const char*>(&_value));
+			const auto& table = field_table<T>;
+			for (size_t i = 0; i != table.size(); i++)
+			{
+				if (table[i].offset == offset)
+				{
+					_dirty.set(i);
+					return field;
+				}
+			}
+			throw std::invalid_argument("the member is not a field of the model");
+		}
+		// Gives write access to the whole value and marks every field.
+		T& edit() noexcept
+		{
+			_dirty.set();
+			return _value;
+		}
+		bool mark(const char* name) noexcept
+		{
+			size_t index = detail::find_field_index<T>(name);
+			if (index == field_descriptor::npos)
+				return false;
+			_dirty.set(index);
+			return true;
+		}
+		void mark_all() noexcept { _dirty.set(); }
+
+		bool dirty() const noexcept { return _dirty.any(); }
+		const field_set& dirty_fields() const noexcept { return _dirty; }
+
+		// The fields to write into target: the dirty ones if target was written last, else all.
+		field_set pending(const write_target& target) const noexcept
+		{
+			return target.id() == _target ? _dirty : field_set().set();
+		}
+		// Records that target now holds the value.
+		void clean(const write_target& target) noexcept
+		{
+			_target = target.id();
+			_dirty.reset();
+		}
+
+	private:
+		T _value;
+		field_set _dirty;
+		std::uint64_t _target;
+	};
+
+	// Writes the fields of v that changed since it was last written into target, which
+	// stands for element. The first write into a target writes every field.
+	template<typename Document, typename T>
+	inline Document& put_dirty(Document& doc, typename Document::element_type& element, tracked<T>& v, const write_target& target)
+	{
+		typename tracked<T>::field_set fields = v.pending(target);
+		const auto& table = field_table<T>;
+		for (size_t i = 0; i != table.size(); i++)
+		{
+			if (fields[i])
+			{
+				detail::struct_info<T>::instance().find_field(i, [&](const auto& field) {
+					field.put(doc, element, v.value());
+				});
+			}
+		}
+		v.clean(target);
+		return doc;
+	}
+
+	template<typename Document, typename T>
+	inline Document& put_dirty(Document&& doc, tracked<T>& v, const write_target& target)
+	{
+		return put_dirty(doc, doc.root(), v, target);
+	}
+
+	// put writes every field; only put_dirty writes less.
+	template<typename Document, typename T>
+	inline Document& put(Document&& doc, const tracked<T>& v)
+	{
+		return leech::put(doc, doc.root(), v.value());
+	}
+
+	template<typename Document, typename T>
+	inline Document& put(Document& doc, typename Document::element_type& element, const tracked<T>& v)
+	{
+		return leech::put(doc, element, v.value());
+	}
+
+}
+
+#endif //_LEECH_TRACKED_HPP_
@@ -0,0 +1,274 @@
+#ifndef _LEECH_WATCHED_HPP_
+#define _LEECH_WATCHED_HPP_
+
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+#include <system_error>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#include "mapped_file.hpp"
+
+namespace leech
+{
+
+	// A value decoded from a file that is reloaded when the file changes. A thread
+	// waits for inotify events on the directory of the file (or polls its status
+	// every interval where inotify is unavailable), decodes the new contents with
+	// the loader and publishes them as a new immutable snapshot. A failed load
+	// goes to the error handler and keeps the previous snapshot. The loader runs in
+	// an unmapped_scope, so a file truncated while it is read is a parse error
+	// rather than a SIGBUS.
+	template<typename T>
+	class watched
+	{
+	public:
+		typedef std::function<void(const std::string& filename, T& value)> loader_type;
+		typedef std::function<void(std::exception_ptr error)> error_handler;
+
+		// Reads snapshots with a single atomic load while the value does not change;
+		// one reader belongs to one thread, and keeps its snapshot alive until the next access.
+		class reader
+		{
+		public:
+			explicit reader(const watched& source) : _source(&source)
+			{
+				_version = source._version.load(std::memory_order_acquire);
+				_snapshot = source.snapshot();
+			}
+
+			const T& get()
+			{
+				size_t version = _source->_version.load(std::memory_order_acquire);
+				if (version != _version)
+				{
+					_snapshot = _source->snapshot();
+					_version = version;
+				}
+				return *_snapshot;
+			}
+			const T& operator*() { return get(); }
+			const T* operator->() { return &get(); }
+
+		private:
+			const watched* _source;
+			size_t _version;
+			std::shared_ptr<const T> _snapshot;
+		};
+
+		// Loads the file once, throwing if that fails, and starts watching it.
+		watched(std::string filename, loader_type loader, error_handler on_error = nullptr,
+			std::chrono::milliseconds interval = std::chrono::milliseconds(1000))
+			: _filename(std::move(filename)), _loader(std::move(loader)), _on_error(std::move(on_error)),
+			_interval(interval), _version(0), _stopping(false)
+		{
+			_signature = signature();
+			publish(load());
+			start();
+		}
+		watched(const watched&) = delete;
+		watched& operator=(const watched&) = delete;
+		~watched() { stop(); }
+
+		// The current value, which stays valid as long as the returned pointer.
+		std::shared_ptr<const T> snapshot() const
+		{
+#ifdef __cpp_lib_atomic_shared_ptr
+			return _snapshot.load(std::memory_order_acquire);
+#else
+			return std::atomic_load_explicit(&_snapshot, std::memory_order_acquire);
+#endif
+		}
+		// Incremented every time a new snapshot is published.
+		size_t version() const noexcept { return _version.load(std::memory_order_acquire); }
+		const std::string& filename() const noexcept { return _filename; }
+
+		// Loads the file now; false if it failed, after calling the error handler.
+		bool reload()
+		{
+			std::lock_guard<std::mutex> lock(_reload_mutex);
+			_signature = signature();
+			try
+			{
+				publish(load());
+				return true;
+			}
+			catch (...)
+			{
+				if (_on_error) _on_error(std::current_exception());
+				return false;
+			}
+		}
+
+	private:
+		std::string _filename;
+		loader_type _loader;
+		error_handler _on_error;
+		std::chrono::milliseconds _interval;
+#ifdef __cpp_lib_atomic_shared_ptr
+		std::atomic<std::shared_ptr<const T>> _snapshot;
+#else
+		std::shared_ptr<const T> _snapshot;
+#endif
+		std::atomic<size_t> _version;
+		std::mutex _reload_mutex;
+		std::string _signature;
+		std::thread _thread;
+		std::atomic<bool> _stopping;
+#ifdef _WIN32
+		std::mutex _wait_mutex;
+		std::condition_variable _wait;
+#else
+		int _wake[2];
+#endif
+
+		std::shared_ptr<const T> load()
+		{
+			std::shared_ptr<T> value = std::make_shared<T>();
+			unmapped_scope scope;
+			_loader(_filename, *value);
+			return value;
+		}
+		void publish(std::shared_ptr<const T>&& value)
+		{
+#ifdef __cpp_lib_atomic_shared_ptr
+			value = _snapshot.exchange(std::move(value), std::memory_order_acq_rel);
+#else
+			value = std::atomic_exchange_explicit(&_snapshot, std::move(value), std::memory_order_acq_rel);
+#endif
+			_version.fetch_add(1, std::memory_order_release);
+			// The old snapshot is released here unless a reader still holds it.
+		}
+		// What identifies a version of the file: device, inode, size and modification time.
+		std::string signature() const
+		{
+			struct stat st;
+			if (stat(_filename.c_str(), &st) != 0)
+				return std::string();
+			return std::to_string(st.st_dev) + ':' + std::to_string(st.st_ino) + ':' +
+				std::to_string(st.st_size) + ':' + std::to_string(static_cast<long long>(st.st_mtime))
+#ifdef __linux__
+				+ '.' + std::to_string(st.st_mtim.tv_nsec)
+#endif
+				;
+		}
+		bool changed()
+		{
+			std::string current = signature();
+			std::lock_guard<std::mutex> lock(_reload_mutex);
+			return !current.empty() && current != _signature;
+		}
+
+#ifdef _WIN32
+		void start()
+		{
+			_thread = std::thread([this]() {
+				std::unique_lock<std::mutex> lock(_wait_mutex);
+				while (!_wait.wait_for(lock, _interval, [this]() { return _stopping.load(); }))
+				{
+					lock.unlock();
+					if (changed()) reload();
+					lock.lock();
+				}
+			});
+		}
+		void stop() noexcept
+		{
+			{
+				std::lock_guard<std::mutex> lock(_wait_mutex);
+				_stopping = true;
+			}
+			_wait.notify_all();
+			if (_thread.joinable()) _thread.join();
+		}
+#else
+		void start()
+		{
+			if (pipe(_wake) != 0)
+				throw std::system_error(errno, std::generic_category(), "pipe");
+			fcntl(_wake[0], F_SETFD, FD_CLOEXEC);
+			fcntl(_wake[1], F_SETFD, FD_CLOEXEC);
+			try
+			{
+				_thread = std::thread([this]() { run(); });
+			}
+			catch (...)
+			{
+				::close(_wake[0]);
+				::close(_wake[1]);
+				throw;
+			}
+		}
+		void stop() noexcept
+		{
+			_stopping = true;
+			if (!_thread.joinable()) return;
+			char c = 0;
+			while (::write(_wake[1], &c, 1) < 0 && errno == EINTR) { }
+			_thread.join();
+			::close(_wake[0]);
+			::close(_wake[1]);
+		}
+		void run()
+		{
+			int notify = watch_directory();
+			pollfd fds[2] = { { _wake[0], POLLIN, 0 }, { notify, POLLIN, 0 } };
+			while (!_stopping)
+			{
+				int n = poll(fds, notify >= 0 ? 2 : 1, static_cast<int>(_interval.count()));
+				if (_stopping) break;
+				if (n > 0 && (fds[1].revents & POLLIN))
+				{
+					// Editors write in several steps; let them finish before reading.
+					std::this_thread::sleep_for(std::chrono::milliseconds(20));
+					drain(notify);
+				}
+				if (changed()) reload();
+			}
+			if (notify >= 0) ::close(notify);
+		}
+		// Watches the directory rather than the file, so replacing the file by a rename is seen too.
+		int watch_directory() const
+		{
+#ifdef __linux__
+			int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			if (fd < 0) return -1;
+			size_t slash = _filename.rfind('/');
+			std::string directory = slash == std::string::npos ? std::string(".") : slash == 0 ? std::string("/") : _filename.substr(0, slash);
+			if (inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_MODIFY) < 0)
+			{
+				::close(fd);
+				return -1;
+			}
+			return fd;
+#else
+			return -1;
+#endif
+		}
+		static void drain(int fd) noexcept
+		{
+			char buffer[4096];
+			while (::read(fd, buffer, sizeof(buffer)) > 0) { }
+		}
+#endif
+	};
+
+}
+
+#endif //_LEECH_WATCHED_HPP_
@@ -4,8 +4,19 @@
 #pragma once
 
 #include <yaml-cpp/yaml.h>
+#include <yaml-cpp/eventhandler.h>
 #include <sstream>
 #include <fstream>
+#include <vector>
+#include <list>
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <string.h>
+#include "model.hpp"
+#include "sax.hpp"
+#include "mapped_file.hpp"
+#include "parallel.hpp"
 
 namespace leech 
 {
@@ -40,7 +51,7 @@ public:
 
 	element_type& root() noexcept { return _root;  }
 	const element_type& root() const noexcept { return _root; }
-	const element_type& operator[](const char* name) const
+	const element_type operator[](const char* name) const
 	{
 		return _root[name];
 	}
@@ -48,7 +59,7 @@ public:
 	{
 		return _root[name];
 	}
-	const element_type& child(const element_type& element, const char* name) const
+	const element_type child(const element_type& element, const char* name) const
 	{
 		return element[name];
 	}
@@ -56,6 +67,21 @@ public:
 	{
 		return element[name];
 	}
+	bool has_child(const element_type& element, const char* name) const
+	{
+		return element.IsMap() && element[name].IsDefined();
+	}
+	// Calls fn(name, child) for each entry of a map, in document order.
+	template<typename Fn>
+	void for_each_child(const element_type& element, Fn&& fn) const
+	{
+		if (!element.IsMap()) return;
+		for (const auto& item : element)
+		{
+			if (item.first.IsScalar())
+				fn(item.first.Scalar().c_str(), item.second);
+		}
+	}
 
 	template<typename T>
 	void put(element_type& element, const T& v) const
@@ -66,13 +92,197 @@ public:
 	template<typename T>
 	void get(const element_type& element, T& v) const
 	{
-		v=element.as<T>();
+		if (!element.IsDefined() || !YAML::convert<T>::decode(element, v))
+			v = element.as<T>();
 	}
 
 private:
 	element_type _root;
 };
 
+// Writes YAML events to a YAML::Emitter straight from the fields of the objects, without
+// building YAML::Node trees. A map is closed lazily, when a sibling or an ancestor is written next.
+class emitter_document
+{
+public:
+	struct frame
+	{
+		enum state_type { empty, map, closed };
+
+		size_t depth;
+		state_type state;
+	};
+	typedef frame element_type;
+
+	emitter_document() : _depth(0)
+	{
+		_frames.push_back(frame{ 0, frame::empty });
+	}
+	explicit emitter_document(std::ostream& os) : _emitter(os), _depth(0)
+	{
+		_frames.push_back(frame{ 0, frame::empty });
+	}
+	emitter_document(const emitter_document&) = delete;
+	emitter_document& operator=(const emitter_document&) = delete;
+
+	element_type& root() noexcept { return _frames.front(); }
+	// The emitter, to set its format options before anything is written.
+	YAML::Emitter& emitter() noexcept { return _emitter; }
+
+	// Completes the document and returns its text, unless it was written to a stream.
+	std::string str()
+	{
+		finish();
+		return std::string(_emitter.c_str(), _emitter.size());
+	}
+	// Completes the document in the stream given to the constructor.
+	void flush()
+	{
+		finish();
+	}
+
+	element_type& child(element_type& element, const char* name)
+	{
+		unwind(element.depth);
+		if (element.state != frame::map)
+		{
+			_emitter << YAML::BeginMap;
+			element.state = frame::map;
+		}
+		_emitter << YAML::Key << name << YAML::Value;
+		return enter(element);
+	}
+
+	template<typename T>
+	void put(element_type& element, const T& v)
+	{
+		unwind(element.depth);
+		write_value(v);
+		element.state = frame::closed;
+	}
+	template<typename T>
+	void put(element_type& element, const std::vector<T>& v)
+	{
+		put_sequence(element, v);
+	}
+	template<typename T>
+	void put(element_type& element, const std::list<T>& v)
+	{
+		put_sequence(element, v);
+	}
+	template<typename T>
+	void put(element_type& element, const std::map<std::string, T>& v)
+	{
+		put_map(element, v);
+	}
+	template<typename T>
+	void put(element_type& element, const std::unordered_map<std::string, T>& v)
+	{
+		put_map(element, v);
+	}
+
+private:
+	YAML::Emitter _emitter;
+	std::deque<frame> _frames;
+	size_t _depth;
+
+	element_type& enter(const element_type& parent)
+	{
+		size_t depth = parent.depth + 1;
+		if (_frames.size() <= depth)
+			_frames.push_back(frame{ depth, frame::empty });
+		frame& result = _frames[depth];
+		result.state = frame::empty;
+		_depth = depth;
+		return result;
+	}
+	void unwind(size_t depth)
+	{
+		for (; _depth > depth; --_depth)
+			close(_frames[_depth]);
+	}
+	void close(frame& f)
+	{
+		// A structure without any field written is an empty map, as in the json writer.
+		if (f.state == frame::map)
+			_emitter << YAML::EndMap;
+		else if (f.state == frame::empty)
+			_emitter << YAML::BeginMap << YAML::EndMap;
+		f.state = frame::closed;
+	}
+	void finish()
+	{
+		unwind(0);
+		if (_frames.front().state != frame::closed)
+			close(_frames.front());
+		if (!_emitter.good())
+			throw YAML::EmitterException(_emitter.GetLastError());
+	}
+
+	template<typename Range>
+	void put_sequence(element_type& element, const Range& v)
+	{
+		unwind(element.depth);
+		_emitter << YAML::BeginSeq;
+		for (const auto& item : v)
+		{
+			leech::put(*this, enter(element), item);
+			unwind(element.depth);
+		}
+		_emitter << YAML::EndSeq;
+		element.state = frame::closed;
+	}
+	template<typename Map>
+	void put_map(element_type& element, const Map& v)
+	{
+		unwind(element.depth);
+		element.state = frame::empty;
+		for (const auto& item : v)
+		{
+			leech::put(*this, child(element, item.first.c_str()), item.second);
+		}
+		unwind(element.depth);
+		if (element.state == frame::empty)
+			_emitter << YAML::BeginMap << YAML::EndMap;
+		else
+			close(element);
+		element.state = frame::closed;
+	}
+
+	void write_value(const std::string& v)
+	{
+		_emitter << v;
+	}
+	void write_value(const char* v)
+	{
+		_emitter << v;
+	}
+	// Characters are written as numbers, which is how reader decodes them.
+	void write_value(char v)
+	{
+		_emitter << static_cast<int>(v);
+	}
+	void write_value(signed char v)
+	{
+		_emitter << static_cast<int>(v);
+	}
+	void write_value(unsigned char v)
+	{
+		_emitter << static_cast<unsigned>(v);
+	}
+	template<typename T>
+	typename std::enable_if<std::is_arithmetic<T>::value>::type write_value(T v)
+	{
+		_emitter << v;
+	}
+	// Other types go through their YAML::convert specialization, as document::put does.
+	template<typename T>
+	typename std::enable_if<!std::is_arithmetic<T>::value>::type write_value(const T& v)
+	{
+		_emitter << YAML::Node(v);
+	}
+};
+
 inline document load(const char* input)
 {
 	return document(YAML::Load(input));
@@ -85,9 +295,301 @@ inline document load(std::istream& input)
 {
 	return document(YAML::Load(input));
 }
-inline document load_file(const char* filename)
+inline document load_file(const char* filename, load_stats* stats = nullptr)
+{
+	load_timer timer(stats);
+	mapped_file file;
+	if (!file.open(filename))
+		return document(YAML::LoadFile(filename));
+	timer.io_done();
+	memory_istream is(file);
+	document doc(YAML::Load(is));
+	timer.parse_done();
+	return doc;
+}
+
+// Adapts the events of YAML::Parser to leech::sax::decoder, so keys are matched to fields
+// as they are parsed and no YAML::Node is built. The events of anchored nodes are
+// recorded, and an alias replays them.
+class reader : public YAML::EventHandler
+{
+public:
+	template<typename T>
+	explicit reader(T& v) : _decoder(v), _depth(0) { }
+
+	template<typename T>
+	void reset(T& v)
+	{
+		_decoder.reset(v);
+		_containers.clear();
+		_anchors.clear();
+		_recording.clear();
+		_depth = 0;
+	}
+
+	// Where the last event was parsed, for error messages.
+	const YAML::Mark& mark() const noexcept { return _mark; }
+
+	void OnDocumentStart(const YAML::Mark& mark) override { _mark = mark; }
+	void OnDocumentEnd() override { }
+
+	void OnNull(const YAML::Mark& mark, YAML::anchor_t anchor) override
+	{
+		_mark = mark;
+		start_anchor(anchor);
+		emit(event{ event::null_value, std::string() });
+	}
+	void OnAlias(const YAML::Mark& mark, YAML::anchor_t anchor) override
+	{
+		_mark = mark;
+		if (anchor >= _anchors.size() || _anchors[anchor].empty())
+			throw sax::error("unknown alias");
+		// An alias inside its own anchor would replay the events it is appending to.
+		for (const auto& item : _recording)
+			if (item.first == anchor)
+				throw sax::error("recursive alias");
+		const std::vector<event>& events = _anchors[anchor];
+		const size_t count = events.size();
+		for (size_t i = 0; i != count; i++)
+			emit(events[i]);
+	}
+	void OnScalar(const YAML::Mark& mark, const std::string&, YAML::anchor_t anchor, const std::string& value) override
+	{
+		_mark = mark;
+		start_anchor(anchor);
+		emit(event{ event::scalar, value });
+	}
+	void OnSequenceStart(const YAML::Mark& mark, const std::string&, YAML::anchor_t anchor, YAML::EmitterStyle::value) override
+	{
+		_mark = mark;
+		start_anchor(anchor);
+		emit(event{ event::start_sequence, std::string() });
+	}
+	void OnSequenceEnd() override
+	{
+		emit(event{ event::end_sequence, std::string() });
+	}
+	void OnMapStart(const YAML::Mark& mark, const std::string&, YAML::anchor_t anchor, YAML::EmitterStyle::value) override
+	{
+		_mark = mark;
+		start_anchor(anchor);
+		emit(event{ event::start_map, std::string() });
+	}
+	void OnMapEnd() override
+	{
+		emit(event{ event::end_map, std::string() });
+	}
+
+private:
+	struct event
+	{
+		enum kind_type { null_value, scalar, start_sequence, end_sequence, start_map, end_map };
+
+		kind_type kind;
+		std::string text;
+	};
+	enum container_state { in_sequence, expect_key, expect_value };
+
+	sax::decoder _decoder;
+	YAML::Mark _mark;
+	std::vector<container_state> _containers;
+	// Recorded events by anchor, and the anchors being recorded with the depth they started at.
+	std::vector<std::vector<event>> _anchors;
+	std::vector<std::pair<YAML::anchor_t, size_t>> _recording;
+	size_t _depth;
+
+	void start_anchor(YAML::anchor_t anchor)
+	{
+		if (anchor == YAML::NullAnchor) return;
+		if (_anchors.size() <= anchor)
+			_anchors.resize(anchor + 1);
+		_anchors[anchor].clear();
+		_recording.emplace_back(anchor, _depth);
+	}
+	void emit(const event& e)
+	{
+		apply(e);
+		if (e.kind == event::start_sequence || e.kind == event::start_map)
+			++_depth;
+		else if (e.kind == event::end_sequence || e.kind == event::end_map)
+			--_depth;
+		for (const auto& item : _recording)
+			_anchors[item.first].push_back(e);
+		// A node is recorded whole once the depth is back to where it started.
+		while (!_recording.empty() && _recording.back().second == _depth)
+			_recording.pop_back();
+	}
+	void apply(const event& e)
+	{
+		if (e.kind == event::end_sequence || e.kind == event::end_map)
+		{
+			_containers.pop_back();
+			if (e.kind == event::end_map)
+				_decoder.end_object();
+			else
+				_decoder.end_array();
+			return;
+		}
+		if (!_containers.empty())
+		{
+			container_state& top = _containers.back();
+			if (top == expect_key)
+			{
+				if (e.kind != event::scalar)
+					throw sax::error("only scalar keys are supported");
+				_decoder.key(e.text);
+				top = expect_value;
+				return;
+			}
+			if (top == expect_value)
+				top = expect_key;
+		}
+		switch (e.kind)
+		{
+		case event::null_value:
+			_decoder.null_value();
+			break;
+		case event::scalar:
+			_decoder.scalar(e.text);
+			break;
+		case event::start_sequence:
+			_decoder.start_array();
+			_containers.push_back(in_sequence);
+			break;
+		default:
+			_decoder.start_object();
+			_containers.push_back(expect_key);
+			break;
+		}
+	}
+};
+
+// Decodes the first document of YAML text directly into v, without building YAML::Node trees.
+// Errors of the decoder are reported as YAML::ParserException, with the position.
+template<typename T>
+inline void read(std::istream& input, T& v)
+{
+	YAML::Parser parser(input);
+	reader handler(v);
+	try
+	{
+		parser.HandleNextDocument(handler);
+	}
+	catch (const sax::error& e)
+	{
+		throw YAML::ParserException(handler.mark(), e.what());
+	}
+}
+template<typename T>
+inline void read(const char* first, const char* last, T& v)
+{
+	memory_istream is(first, static_cast<size_t>(last - first));
+	read(is, v);
+}
+template<typename T>
+inline void read(const std::string& input, T& v)
+{
+	read(input.data(), input.data() + input.size(), v);
+}
+template<typename T>
+inline void read(const char* input, T& v)
+{
+	read(input, input + strlen(input), v);
+}
+template<typename T>
+inline void read_file(const char* filename, T& v, load_stats* stats = nullptr)
+{
+	load_timer timer(stats);
+	mapped_file file;
+	if (!file.open(filename))
+	{
+		std::ifstream fs(filename);
+		if (!fs)
+			throw YAML::Exception(YAML::Mark::null_mark(), std::string("bad file: ") + filename);
+		read(fs, v);
+		return;
+	}
+	timer.io_done();
+	read(file.begin(), file.end(), v);
+	timer.parse_done();
+}
+
+typedef std::vector<std::pair<const char*, const char*>> ranges;
+
+inline bool is_marker(const char* line, size_t length, char c) noexcept
+{
+	return length >= 3 && line[0] == c && line[1] == c && line[2] == c &&
+		(length == 3 || line[3] == ' ' || line[3] == '\t' || line[3] == '\r' || line[3] == '\n');
+}
+
+// Finds the documents of a YAML stream in [first, last). A document starts at a "---"
+// line and ends at the next one or at a "..." line; documents without content are skipped.
+inline ranges split_documents(const char* first, const char* last)
+{
+	ranges result;
+	const char* start = first;
+	bool content = false;
+	for (const char* line = first; line != last; )
+	{
+		const char* end = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(last - line)));
+		end = end ? end + 1 : last;
+		size_t length = static_cast<size_t>(end - line);
+		const char* text = line;
+		if (is_marker(line, length, '-') || is_marker(line, length, '.'))
+		{
+			if (content)
+				result.emplace_back(start, line);
+			content = false;
+			if (line[0] == '.')
+			{
+				start = end;
+				line = end;
+				continue;
+			}
+			start = line;
+			text = line + 3;
+		}
+		else if (line[0] == '%' && !content)
+		{
+			line = end;
+			continue;
+		}
+		while (text != end && (*text == ' ' || *text == '\t' || *text == '\r' || *text == '\n')) ++text;
+		if (text != end && *text != '#')
+			content = true;
+		line = end;
+	}
+	if (content)
+		result.emplace_back(start, last);
+	return result;
+}
+
+// Decodes the documents of a large YAML stream into v on several threads (0 for every
+// hardware thread), one element per document.
+template<typename T>
+inline void parallel_get(const char* first, const char* last, std::vector<T>& v, size_t threads = 0)
+{
+	static_assert(!std::is_same<T, bool>::value, "std::vector<bool> cannot be decoded in parallel");
+	ranges items = split_documents(first, last);
+	v.resize(items.size());
+	parallel_for(items.size(), threads, [&items, &v](size_t begin, size_t end) {
+		for (size_t i = begin; i != end; i++)
+		{
+			memory_istream is(items[i].first, static_cast<size_t>(items[i].second - items[i].first));
+			document doc(YAML::Load(is));
+			leech::get(doc, v[i]);
+		}
+	});
+}
+template<typename T>
+inline void parallel_get(const std::string& input, std::vector<T>& v, size_t threads = 0)
+{
+	parallel_get(input.data(), input.data() + input.size(), v, threads);
+}
+template<typename T>
+inline void parallel_get(const mapped_file& input, std::vector<T>& v, size_t threads = 0)
 {
-	return document(YAML::LoadFile(filename));
+	parallel_get(input.begin(), input.end(), v, threads);
 }
 
 }
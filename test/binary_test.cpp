@@ -0,0 +1,63 @@
+#include "pch.h"
+#include "test.h"
+#include <leech/binary.hpp>
+#include <cstdio>
+
+using namespace std;
+
+struct Counters
+{
+	int port;
+	int connections;
+	std::string host;
+};
+
+STRUCT_MODEL(Counters, port, ((connections), skip_write), host)
+
+void test_binary()
+{
+	MyStruct s{ };
+	s.id = -1;
+	s.enabled = true;
+	s.a = 100;
+	s.b = 200;
+	s.c = 300;
+	s.d = { 1, 2 };
+	s.node.name = "aaaaa";
+
+	try
+	{
+		leech::binary::document doc;
+		leech::put(doc, s);
+		cout << "size:" << doc.save().size() << endl;
+
+		MyStruct other{ };
+		leech::binary::document input = leech::binary::load(doc.save());
+		leech::get(input, other);
+		cout << boolalpha;
+		leech::for_each(other, [](const char* name, const auto& v) {
+			cout << name << ":" << v << ", ";
+		});
+		cout << endl;
+
+		doc.save_file("test.bin");
+		MyStruct mapped{ };
+		leech::get(leech::binary::load_file("test.bin"), mapped);
+		std::remove("test.bin");
+		cout << "mapped:" << mapped.node.name << endl;
+
+		leech::binary::document counters_out;
+		leech::put(counters_out, Counters{ 8080, 3, "localhost" });
+		Counters counters{ };
+		leech::get(leech::binary::load(counters_out.save()), counters);
+		cout << "skip_write:" << counters.port << " " << counters.connections << " " << counters.host << endl;
+
+		for (const leech::field_descriptor& field : leech::field_descriptors<MyStruct>())
+			cout << field.name << "@" << field.offset << ", ";
+		cout << endl;
+	}
+	catch (std::exception& e)
+	{
+		cerr << e.what() << endl;
+	}
+}
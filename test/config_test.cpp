@@ -1,6 +1,8 @@
 #include "pch.h"
 #include "test.h"
 #include <leech/config.hpp>
+#include <fstream>
+#include <cstdio>
 
 using namespace std;
 
@@ -10,6 +12,27 @@ void test_config()
 
 	try
 	{
+		MyStruct r{ };
+		leech::config::read("id = 1; enabled = true; a = 2; b = 3; c = 4; d = [ 1, 2 ];\nnode = { name = \"n\"; };", r);
+		cout << "read:" << r.a << " " << r.d.size() << " " << r.node.name << endl;
+		ofstream("include.cfg") << "id = 1;\nenabled = \"yes\";\n";
+		ofstream("include_ok.cfg") << "id = 1;\n";
+		for (const char* text : { "@include \"include.cfg\"\n", "@include \"include_ok.cfg\"\n\nenabled = 2;\n" })
+		{
+			try { leech::config::read(text, r); }
+			catch (leech::config::error& e) { cout << "include:" << e.what() << endl; }
+		}
+		std::remove("include.cfg");
+		std::remove("include_ok.cfg");
+		leech::config::document order;
+		order["a"] = 1;
+		order["b"] = 2;
+		order["a"] = std::string("one");
+		order["a"] = vector<int>{ 1 };
+		cout << "order:";
+		order.for_each_child(order.root(), [](const char* name, const leech::config::setting&) { cout << name; });
+		cout << endl;
+
 		leech::config::document doc;
 		doc.load_file("\\a.cfg");
 
@@ -20,6 +43,8 @@ void test_config()
 		});
 		cout << endl;
 
+		doc.put(doc["d"], s.d);
+		doc.put(doc["d"], vector<int>{ 1, 2 });
 		doc.put(doc.root(), s.d);
 		doc.save(stdout);
 
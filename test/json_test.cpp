@@ -1,17 +1,74 @@
 #include "pch.h"
 #include "test.h"
 #include <leech/json.hpp>
+#include <leech/delta.hpp>
+#include <leech/watched.hpp>
 #include <fstream>
+#include <set>
+#include <sstream>
 
 using namespace std;
 
+struct Listener
+{
+	int port;
+	std::string host;
+	std::string title;
+	int connections;
+};
+
+STRUCT_MODEL(Listener, ((port), rename("listen_port"), default_value(8080)), ((host), optional),
+	((title), alias("name")), ((connections), skip_write))
+
+struct Endpoint : public Listener
+{
+	int weight;
+};
+
+STRUCT_MODEL_INHERIT(Endpoint, (Listener), weight)
+
+struct Switches
+{
+	std::vector<bool> flags;
+};
+
+STRUCT_MODEL(Switches, flags)
+
+struct Quoted
+{
+	int width;
+};
+
+STRUCT_MODEL(Quoted, ((width), rename("say \"w\"\\")))
+
+#ifdef LEECH_HAS_PMR
+struct ArenaRecord
+{
+	std::pmr::string name;
+	std::pmr::vector<int> values;
+};
+
+STRUCT_MODEL(ArenaRecord, name, values)
+#endif
+
+#ifdef LEECH_HAS_STRING_VIEW
+struct ViewNode
+{
+	std::string_view name;
+};
+
+STRUCT_MODEL(ViewNode, name)
+#endif
+
 void test_json()
 {
 	MyStruct s{ };
 
 	try
 	{
-		leech::json::document ar=leech::json::load_file("test.json");
+		leech::load_stats stats;
+		leech::json::document ar=leech::json::load_file("test.json", &stats);
+		cout << "load: io " << stats.io.count() << "ns, parse " << stats.parse.count() << "ns" << endl;
 		leech::get(ar, ar["aaa"], s);
 		cout << boolalpha;
 		leech::for_each(s, [](const char* name, const auto& v) {
@@ -21,6 +78,140 @@ void test_json()
 		leech::find_field<MyStruct>("a", [](auto& field_info) {
 			cout << "found field:" << field_info.name() << endl;
 		});
+		leech::find_field<MyStruct>(leech::field_count<MyStruct>() - 1, [](const auto& field_info) {
+			cout << "last field:" << field_info.name() << endl;
+		});
+		cout << "field 3:" << leech::get_field<3>(s) << endl;
+
+		leech::json::writer writer;
+		leech::put(writer, s);
+		cout << writer.str() << endl;
+		leech::json::writer floats;
+		leech::put(floats, std::vector<float>{ 0.1f, 1.0f, 1e-5f });
+		cout << "floats:" << floats.str() << endl;
+		// Laid out as nlohmann::json::dump: fixed notation below 1e15, an exponent from there.
+		const std::vector<double> doubles{ 1e14, 1e15, 123456789012345.6, 1e-4, 5e-324 };
+		leech::json::writer doubles_writer;
+		leech::put(doubles_writer, doubles);
+		cout << "doubles:" << doubles_writer.str() << " " << (doubles_writer.str() == nlohmann::json(doubles).dump()) << endl;
+		leech::json::writer unsigned_writer;
+		leech::put(unsigned_writer, std::vector<unsigned>{ 0u, 4294967295u });
+		cout << "unsigned:" << unsigned_writer.str() << endl;
+
+		std::map<std::string, MyStruct> records;
+		leech::json::read_file("test.json", records);
+		cout << "read:" << records["aaa"].node.name << endl;
+
+		std::stringstream lines;
+		{
+			leech::json::record_writer<MyStruct> records_out(lines);
+			records_out.write(s);
+			records_out.write(s);
+		}
+		size_t count = 0;
+		std::set<const int*> buffers;
+		for (const MyStruct& record : leech::json::record_reader<MyStruct>(lines))
+		{
+			count += record.node.name == s.node.name;
+			buffers.insert(record.d.data());
+		}
+		cout << "records:" << count << " " << buffers.size() << endl;
+
+		std::vector<MyStruct> items;
+		leech::json::parallel_get(std::string("[") + writer.str() + "," + writer.str() + "]", items, 2);
+		cout << "parallel:" << items.size() << endl;
+
+		for (size_t i = 0; i != 2; i++)
+		{
+			MyStruct copy{ };
+			leech::get_ordered(leech::json::load(writer.str()), copy);
+		}
+		const leech::key_order_stats& order = leech::key_order_statistics<MyStruct>();
+		cout << "key order: " << order.hits << " hits, " << order.misses << " misses" << endl;
+
+		MyStruct changed = s;
+		changed.b = 201;
+		changed.node.name = "bbbbb";
+		leech::json::writer delta_writer;
+		leech::put_delta(delta_writer, leech::diff(s, changed));
+		cout << "delta:" << delta_writer.str() << endl;
+		MyStruct patched = s;
+		leech::apply_delta(leech::json::load(delta_writer.str()), patched);
+		cout << "applied:" << leech::equal(patched, changed) << endl;
+
+		leech::tracked<MyStruct> state(s);
+		leech::json::fragment_cache<MyStruct> cache;
+		cache.str(state);
+		state.edit(&MyStruct::c) = 301;
+		cout << "dirty:" << state.dirty_fields() << endl;
+		cout << "cached:" << cache.str(state) << endl;
+		leech::tracked<Quoted> quoted(Quoted{ 5 });
+		leech::json::fragment_cache<Quoted> quoted_cache;
+		cout << "cached quoted:" << quoted_cache.str(quoted) << endl;
+		leech::write_target target;
+		leech::json::document saved;
+		leech::put_dirty(saved, state, target);
+		state.edit(&MyStruct::b) = 201;
+		leech::put_dirty(saved, state, target);
+		leech::json::document fresh;
+		leech::put_dirty(fresh, state, leech::write_target());
+		cout << "put_dirty:" << saved.save() << " " << (saved.save() == fresh.save()) << endl;
+
+		leech::watched<std::map<std::string, MyStruct>> watched("test.json", [](const std::string& filename, std::map<std::string, MyStruct>& v) {
+			leech::json::read_file(filename.c_str(), v);
+		});
+		leech::watched<std::map<std::string, MyStruct>>::reader snapshot(watched);
+		watched.reload();
+		Listener listener{ };
+		leech::json::read(std::string(R"({"name":"listener","connections":3})"), listener);
+		leech::json::writer listener_writer;
+		leech::put(listener_writer, listener);
+		cout << "attributes:" << listener_writer.str() << " " << listener.connections << endl;
+		Listener got{ }, ordered{ };
+		got.port = ordered.port = 1;
+		const std::string bad_port = R"({"listen_port":"bad","name":"listener","connections":7})";
+		leech::get(leech::json::load(bad_port), got);
+		leech::get_ordered(leech::json::load(bad_port), ordered);
+		cout << "bad default:" << got.port << " " << ordered.port << endl;
+		size_t alias_hits = leech::key_order_statistics<Listener>().hits;
+		ordered.title.clear();
+		leech::get_ordered(leech::json::load(bad_port), ordered);
+		cout << "alias order:" << ordered.title << " " << leech::key_order_statistics<Listener>().hits - alias_hits << " hits" << endl;
+		Endpoint endpoint{ };
+		leech::json::read(std::string(R"({"weight":2,"name":"endpoint","listen_port":81,"connections":1})"), endpoint);
+		cout << "inherited keys:" << endpoint.title << " " << endpoint.port << " " << endpoint.weight << " "
+			<< leech::find_descriptor<Endpoint>("name")->name << " " << (leech::find_descriptor<Endpoint>("port") == nullptr) << endl;
+		std::vector<bool> flags;
+		leech::get(leech::json::load(std::string("[true,false,true]")), flags);
+		cout << "flags:" << flags[0] << flags[1] << flags[2] << endl;
+		Switches switches{ };
+		leech::json::read(std::string(R"({"flags":[false,true]})"), switches);
+		cout << "read flags:" << switches.flags.size() << switches.flags[0] << switches.flags[1] << endl;
+		for (const char* text : { R"({"id":1,"id":2})", R"({"id":null,"enabled":true})" })
+		{
+			Base base{ };
+			try { leech::json::read(std::string(text), base); }
+			catch (leech::sax::error& e) { cout << "rejected:" << e.what() << endl; }
+		}
+
+		cout << "watched:" << snapshot->at("aaa").node.name << " version " << watched.version() << endl;
+
+#ifdef LEECH_HAS_PMR
+		std::pmr::monotonic_buffer_resource arena;
+		leech::decode_context context(&arena);
+		std::pmr::vector<ArenaRecord> arena_records(&arena);
+		leech::json::read(std::string(R"([{"name":"record decoded into the arena","values":[1,2,3]}])"), arena_records);
+		cout << "arena:" << (arena_records[0].name.get_allocator().resource() == &arena) << endl;
+#endif
+
+#ifdef LEECH_HAS_STRING_VIEW
+		leech::json::view_document view = leech::json::load_view_file("test.json");
+		ViewNode view_node{ };
+		leech::get(view, view.child(view.child(view.root(), "aaa"), "node"), view_node);
+		cout << "view:" << view_node.name << endl;
+		leech::get(leech::json::load_view(std::string("[false,true]")), flags);
+		cout << "view flags:" << flags[0] << flags[1] << endl;
+#endif
 	}
 	catch (std::exception& e)
 	{
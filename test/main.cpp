@@ -6,6 +6,8 @@ using namespace std;
 void test_yaml();
 void test_json();
 void test_config();
+void test_binary();
+void test_toml();
 
 int main()
 {
@@ -15,6 +17,10 @@ int main()
 	test_json();
 	cout << "config: " << endl;
 	test_config();
+	cout << "binary: " << endl;
+	test_binary();
+	cout << "toml: " << endl;
+	test_toml();
 
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,62 @@
+#include "pch.h"
+#include "test.h"
+
+#if defined(__has_include)
+#if __has_include(<toml.hpp>)
+#define LEECH_TEST_TOML
+#endif
+#endif
+
+#ifdef LEECH_TEST_TOML
+#include <leech/toml.hpp>
+#include <leech/delta.hpp>
+#include <sstream>
+#endif
+
+using namespace std;
+
+#ifdef LEECH_TEST_TOML
+struct Manifest
+{
+	std::string title;
+	double ratio;
+	std::vector<std::string> tags;
+	MyStruct record;
+};
+
+STRUCT_MODEL(Manifest, title, ratio, tags, record)
+#endif
+
+void test_toml()
+{
+#ifdef LEECH_TEST_TOML
+	Manifest m{ };
+	m.title = "say \"hi\"\n";
+	m.ratio = 0.1;
+	m.tags = { "a", "b" };
+	m.record.id = -1;
+	m.record.enabled = true;
+	m.record.a = 100;
+	m.record.b = 200;
+	m.record.c = 300;
+	m.record.d = { 1, 2 };
+	m.record.node.name = "aaaaa";
+
+	try
+	{
+		leech::toml::writer writer;
+		leech::put(writer, m);
+		cout << writer.str();
+		std::istringstream is(writer.str());
+		Manifest read{ };
+		leech::get(leech::toml::load(is), read);
+		cout << "round trip:" << leech::equal(m, read) << endl;
+	}
+	catch (std::exception& e)
+	{
+		cerr << e.what() << endl;
+	}
+#else
+	cout << "skipped, toml11 is not installed" << endl;
+#endif
+}
@@ -1 +1 @@
-﻿#include "pch.h"#include "test.h"#include <leech/yaml.hpp>using namespace std;void test_yaml(){	MyStruct s{ };	try	{		leech::yaml::document ar=leech::yaml::load_file("test.yml");		leech::get(ar, ar["aaa"], s);		cout << boolalpha;		cout << endl << "visit" << endl;		leech::visit("", s, [](const char* name, const auto& v) {			cout <<  name << ":" << v << ", ";		});		leech::assign(s, "a", 1234);		cout << endl << "for each" << endl;		leech::for_each(s, [](const char* name, const auto& v) {			cout << name << ":" << v << ", ";		});		cout << endl;		leech::find_field<MyStruct>("a", [](auto& field_info) {			cout << "found field: " << field_info.name() << endl;		});	}	catch (YAML::Exception& e)	{		cerr << e.what() << endl;	}}
\ No newline at end of file
+﻿#include "pch.h"#include "test.h"#include <leech/yaml.hpp>using namespace std;struct Hidden{	int secret;};STRUCT_MODEL(Hidden, ((secret), skip_write, optional))struct Graded{	char grade;	Hidden hidden;};STRUCT_MODEL(Graded, grade, hidden)void test_yaml(){	MyStruct s{ };	try	{		leech::yaml::document ar=leech::yaml::load_file("test.yml");		leech::get(ar, ar["aaa"], s);		cout << boolalpha;		cout << endl << "visit" << endl;		leech::visit("", s, [](const char* name, const auto& v) {			cout <<  name << ":" << v << ", ";		});		leech::assign(s, "a", 1234);		cout << endl << "for each" << endl;		leech::for_each(s, [](const char* name, const auto& v) {			cout << name << ":" << v << ", ";		});		cout << endl;		leech::find_field<MyStruct>("a", [](auto& field_info) {			cout << "found field: " << field_info.name() << endl;		});		leech::yaml::emitter_document out;		leech::put(out, s);		cout << out.str() << endl;		map<string, MyNode> nodes;		leech::yaml::read("first: &node { name: aaa }\nsecond: *node\n", nodes);		cout << "read:" << nodes["second"].name << endl;		try { vector<int> looped; leech::yaml::read("&a [ 1, *a ]", looped); }		catch (YAML::ParserException& e) { cout << "rejected:" << e.what() << endl; }		try { vector<int> fractions; leech::yaml::read("[ 1, 1.5 ]", fractions); }		catch (YAML::ParserException& e) { cout << "rejected:" << e.what() << endl; }		vector<double> specials;		leech::yaml::read("[ -.inf, +.inf, -.nan, +.NaN, -1.5 ]", specials);		cout << "specials:" << specials[0] << " " << specials[1] << " " << std::isnan(specials[2]) << " " << std::isnan(specials[3]) << " " << specials[4] << endl;		leech::yaml::emitter_document graded_out;		leech::put(graded_out, Graded{ 'B', Hidden{ 1 } });		Graded graded{ };		leech::yaml::read(graded_out.str(), graded);		cout << "emitter:" << graded.grade << endl;	}	catch (YAML::Exception& e)	{		cerr << e.what() << endl;	}}
\ No newline at end of file